@@ -0,0 +1,55 @@
+#!/bin/sh
+# Benchmark do simulador: gera figuras sintéticas com o figgen numa matriz drones x passos, corre o
+# simulador em cada uma e escreve uma linha TSV por figura (ver "make bench").
+#
+# Variáveis de ambiente (todas opcionais):
+#   BENCH_DRONES  lista de números de drones      (default: "100 1000 5000")
+#   BENCH_STEPS   lista de números de passos      (default: "100 10000")
+#   BENCH_RATE    fração de drones que colide     (default: 0.01)
+#   BENCH_FLAGS   opções extra do simulador       (default: "--executor=threads")
+#   BENCH_DATA    diretoria das figuras geradas   (default: bench_data)
+#   BENCH_OUT     ficheiro de resultados          (default: bench_results.tsv)
+
+set -e
+
+DRONES="${BENCH_DRONES:-100 1000 5000}"
+STEPS="${BENCH_STEPS:-100 10000}"
+RATE="${BENCH_RATE:-0.01}"
+FLAGS="${BENCH_FLAGS:---executor=threads}"
+DATA="${BENCH_DATA:-bench_data}"
+OUT="${BENCH_OUT:-bench_results.tsv}"
+
+ROOT=$(pwd)
+SIM="$ROOT/drone_simulation"
+GEN="$ROOT/figgen"
+
+mkdir -p "$DATA"
+printf 'drones\tsteps\tflags\tsteps_run\tcollisions\telapsed_s\tsteps_per_s\tpair_checks\tpair_checks_per_s\tpeak_rss_kb\n' > "$OUT"
+
+for n in $DRONES; do
+    for s in $STEPS; do
+        dir="$DATA/n${n}_s${s}"
+        if [ ! -f "$dir/figure.txt" ]; then
+            "$GEN" --drones="$n" --steps="$s" --collision-rate="$RATE" --out="$dir" > /dev/null
+        fi
+
+        # Os scripts da figura são relativos à sua diretoria, onde também fica o relatório
+        log="$dir/bench_output.log"
+        (cd "$dir" && echo 1 | "$SIM" --quiet --max-collisions=1000000000 $FLAGS figure.txt > bench_output.log 2>&1) || {
+            echo "Simulation failed for $dir (see $log)" >&2
+            exit 1
+        }
+
+        awk -v n="$n" -v s="$s" -v flags="$FLAGS" '
+            /^Simulation completed after/ { steps = $4 }
+            /^Total collisions:/          { collisions = $3 }
+            /^Step throughput/            { rate = $(NF - 3); elapsed = substr($(NF - 1), 2) }
+            /^Pair checks:/               { checks = $3; check_rate = substr($4, 2) }
+            /^Peak RSS:/                  { rss = $3 }
+            END { printf "%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n", n, s, flags, steps, collisions, elapsed, rate, checks, check_rate, rss }
+        ' "$log" >> "$OUT"
+        tail -n 1 "$OUT"
+    done
+done
+
+echo "Results written to $OUT"
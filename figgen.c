@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <errno.h>
+#include <limits.h>
+
+// Bibliotecas para criar a diretoria de saída
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define COLLISION_THRESHOLD 1.0 // Distância mínima entre drones (igual à do simulador, em metros)
+#define DRIFT_FRACTION 0.8 // Fração da folga entre vizinhos usada pelo movimento dos drones
+
+// Gerador de figuras sintéticas para o benchmark do simulador.
+//
+// Os drones ficam numa grelha cúbica com o espaçamento dado pela densidade e cada um oscila à volta
+// do seu ponto da grelha seguindo um de --patterns scripts de passeio aleatório limitado. Como cada
+// drone nunca se afasta mais de (espaçamento - limiar) / 2 do seu ponto, a figura não tem colisões
+// acidentais: as únicas colisões são as injetadas por --collision-rate, em que um drone salta para a
+// posição de um vizinho parado num passo escolhido.
+//
+// Os nomes dos scripts são relativos à diretoria de saída: o simulador deve ser corrido a partir dela.
+
+// Parâmetros da figura gerada
+typedef struct
+{
+    int drones;
+    int steps;
+    double density;        // Drones por 1000 m^3 (8 = espaçamento de 5 m)
+    double collision_rate; // Fração dos drones que colide
+    int patterns;          // Scripts distintos de movimento
+    unsigned long seed;
+    const char *out_dir;
+} GeneratorConfig;
+
+GeneratorConfig config = { 100, 100, 8.0, 0.0, 64, 1, "bench_data" };
+
+unsigned long rng_state;
+
+// Gerador xorshift64*, para que a mesma semente produza sempre a mesma figura
+static double random_unit()
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return ((rng_state * 2685821657736338717UL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void print_usage(const char *program)
+{
+    printf("Usage: %s [options]\n", program);
+    printf("Options:\n");
+    printf("  --drones=N            Number of drones (default: 100)\n");
+    printf("  --steps=N             Moves per script (default: 100)\n");
+    printf("  --density=D           Drones per 1000 m^3; sets the grid spacing (default: 8, 5 m apart)\n");
+    printf("  --collision-rate=R    Fraction of drones steered into a collision, 0..1 (default: 0)\n");
+    printf("  --patterns=N          Distinct movement scripts shared by the drones (default: 64)\n");
+    printf("  --seed=N              Random seed (default: 1)\n");
+    printf("  --out=DIR             Output directory for figure.txt and the scripts (default: bench_data)\n");
+}
+
+// Lê o valor inteiro de uma opção "--nome=N"; devolve true se a opção corresponder e for válida
+static bool parse_int_option(const char *arg, const char *prefix, int min_value, int *value)
+{
+    size_t len = strlen(prefix);
+    if (strncmp(arg, prefix, len) != 0) return false;
+
+    char *end;
+    long parsed = strtol(arg + len, &end, 10);
+    if (end == arg + len || *end != '\0' || parsed < min_value || parsed > 1000000000L) return false;
+
+    *value = (int)parsed;
+    return true;
+}
+
+// Lê o valor real de uma opção "--nome=X" dentro de [min_value, max_value]
+static bool parse_double_option(const char *arg, const char *prefix, double min_value, double max_value, double *value)
+{
+    size_t len = strlen(prefix);
+    if (strncmp(arg, prefix, len) != 0) return false;
+
+    char *end;
+    double parsed = strtod(arg + len, &end);
+    if (end == arg + len || *end != '\0' || parsed < min_value || parsed > max_value) return false;
+
+    *value = parsed;
+    return true;
+}
+
+int parse_options(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        int seed;
+        if (parse_int_option(argv[i], "--drones=", 1, &config.drones)) {
+        } else if (parse_int_option(argv[i], "--steps=", 1, &config.steps)) {
+        } else if (parse_double_option(argv[i], "--density=", 1e-6, 1e6, &config.density)) {
+        } else if (parse_double_option(argv[i], "--collision-rate=", 0.0, 1.0, &config.collision_rate)) {
+        } else if (parse_int_option(argv[i], "--patterns=", 1, &config.patterns)) {
+        } else if (parse_int_option(argv[i], "--seed=", 0, &seed)) {
+            config.seed = (unsigned long)seed;
+        } else if (strncmp(argv[i], "--out=", 6) == 0 && argv[i][6] != '\0') {
+            config.out_dir = argv[i] + 6;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Abre um ficheiro dentro da diretoria de saída
+static FILE *open_output(const char *name)
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", config.out_dir, name);
+
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        perror("Error creating output file");
+        exit(EXIT_FAILURE);
+    }
+    return file;
+}
+
+// Escreve um script de passeio aleatório em que o drone nunca se afasta mais de "radius" do ponto
+// inicial. As posições são arredondadas a 4 casas decimais antes de se calcularem os deslocamentos,
+// para que a soma feita pelo simulador reproduza a trajetória.
+static void write_pattern_script(const char *name, double radius)
+{
+    FILE *file = open_output(name);
+    double bound = radius / sqrt(3.0); // Limite por eixo: a norma fica dentro de radius
+    double offset[3] = { 0.0, 0.0, 0.0 };
+    double previous[3] = { 0.0, 0.0, 0.0 };
+
+    for (int t = 1; t <= config.steps; t++) {
+        double delta[3];
+        for (int a = 0; a < 3; a++) {
+            offset[a] += (2.0 * random_unit() - 1.0) * bound * 0.25;
+            if (offset[a] > bound) offset[a] = bound;
+            if (offset[a] < -bound) offset[a] = -bound;
+
+            double rounded = round(offset[a] * 1e4) / 1e4;
+            delta[a] = rounded - previous[a];
+            previous[a] = rounded;
+        }
+        fprintf(file, "%.1f %.4f %.4f %.4f\n", (double)t, delta[0], delta[1], delta[2]);
+    }
+    fclose(file);
+}
+
+// Escreve um script parado que, no passo "jump_step", avança "jump" metros em x (0 = sempre parado)
+static void write_jump_script(const char *name, int jump_step, double jump)
+{
+    FILE *file = open_output(name);
+
+    for (int t = 1; t <= config.steps; t++) {
+        fprintf(file, "%.1f %.4f 0.0000 0.0000\n", (double)t, t == jump_step ? jump : 0.0);
+    }
+    fclose(file);
+}
+
+int main(int argc, char *argv[])
+{
+    if (parse_options(argc, argv) != 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    rng_state = config.seed * 0x9E3779B97F4A7C15UL + 1;
+
+    if (mkdir(config.out_dir, 0755) == -1 && errno != EEXIST) {
+        perror("Error creating output directory");
+        return 1;
+    }
+
+    // Grelha cúbica com espaçamento tal que cada drone ocupa 1000 / density m^3
+    double spacing = 10.0 / cbrt(config.density);
+    double radius = (spacing - COLLISION_THRESHOLD) / 2.0 * DRIFT_FRACTION;
+    int side = (int)ceil(cbrt((double)config.drones));
+    while (side * side * side < config.drones) side++;
+    if (radius <= 0.0) {
+        fprintf(stderr, "Warning: grid spacing %.2f m is below the collision threshold; drones will hover\n", spacing);
+        radius = 0.0;
+    }
+
+    // Pares de colisão: drones vizinhos em x (i, i + 1) com x par, escolhidos ao acaso e disjuntos
+    int pair_target = (int)lround(config.collision_rate * config.drones / 2.0);
+    int *role = calloc(config.drones, sizeof(int)); // 0 = padrão, 1 = salta, 2 = parado
+    int *pair_slot = calloc(config.drones, sizeof(int));
+    int *candidates = malloc(config.drones * sizeof(int));
+    if (!role || !pair_slot || !candidates) {
+        perror("Failed to allocate drone tables");
+        return 1;
+    }
+    int candidate_count = 0;
+    for (int i = 0; i + 1 < config.drones; i++) {
+        if ((i % side) % 2 == 0 && i % side != side - 1) {
+            candidates[candidate_count++] = i;
+        }
+    }
+    if (pair_target > candidate_count) {
+        fprintf(stderr, "Warning: only %d collision pairs fit in the grid\n", candidate_count);
+        pair_target = candidate_count;
+    }
+    for (int k = 0; k < pair_target; k++) {
+        int pick = k + (int)(random_unit() * (candidate_count - k));
+        int i = candidates[pick];
+        candidates[pick] = candidates[k];
+        candidates[k] = i;
+        role[i] = 1;
+        role[i + 1] = 2;
+        pair_slot[i] = k;
+    }
+
+    // Os saltos são espalhados pelos passos, partilhando no máximo --patterns scripts de colisão
+    int jump_scripts = pair_target < config.patterns ? pair_target : config.patterns;
+    char name[64];
+    for (int p = 0; p < config.patterns; p++) {
+        snprintf(name, sizeof(name), "pattern_%d_script.txt", p);
+        write_pattern_script(name, radius);
+    }
+    write_jump_script("hold_script.txt", 0, 0.0);
+    for (int c = 0; c < jump_scripts; c++) {
+        snprintf(name, sizeof(name), "collide_%d_script.txt", c);
+        write_jump_script(name, 1 + (int)((long long)c * config.steps / jump_scripts), spacing);
+    }
+
+    FILE *figure = open_output("figure.txt");
+    for (int i = 0; i < config.drones; i++) {
+        double x = (i % side) * spacing;
+        double y = ((i / side) % side) * spacing;
+        double z = (i / (side * side)) * spacing + spacing;
+
+        if (role[i] == 1) {
+            snprintf(name, sizeof(name), "collide_%d_script.txt", pair_slot[i] % jump_scripts);
+        } else if (role[i] == 2) {
+            snprintf(name, sizeof(name), "hold_script.txt");
+        } else {
+            snprintf(name, sizeof(name), "pattern_%d_script.txt", (int)(random_unit() * config.patterns));
+        }
+        fprintf(figure, "%s %.2f %.2f %.2f\n", name, x, y, z);
+    }
+    fclose(figure);
+
+    printf("Generated %s/figure.txt: %d drones, %d steps, %.2f m spacing, %d collision pairs\n",
+           config.out_dir, config.drones, config.steps, spacing, pair_target);
+
+    free(role);
+    free(pair_slot);
+    free(candidates);
+    return 0;
+}
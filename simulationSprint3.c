@@ -8,24 +8,41 @@
 #include <math.h>
 #include <time.h>
 #include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <sys/resource.h>
 
 // Bibliotecas para memória partilhada
 #include <sys/mman.h>
 #include <sys/stat.h> 
 #include <fcntl.h> 
+#include <dirent.h>
 #include <sys/types.h>
 
-// Bibliotecas para semáforos
+// Bibliotecas para semáforos e futexes
 #include <semaphore.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 
 // Bibliotecas para threads
 #include <pthread.h>
 
-#define MAX_DRONES 100 // Número máximo de drones
-#define MAX_STEPS 1000
-#define MAX_COLLISIONS 10 // Número máximo de colisões
+// Intrínsecas SIMD (SSE2/AVX2), escolhidas em tempo de execução
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+#define DEFAULT_MAX_COLLISIONS 10 // Número máximo de colisões por omissão (--max-collisions)
 #define COLLISION_THRESHOLD 1.0 // Distância mínima entre drones (em metros)
 #define REPORT_FILENAME "simulation_report.txt"
+#define DRONE_TASK_CHUNK 16 // Drones retirados de cada vez por uma thread do executor
+#define LOG_RING_CAPACITY 16384 // Eventos no anel de log partilhado (potência de 2)
+#define LOG_EVENT_VALUES 6 // Valores reais transportados por cada evento de log
+#define TIMING_SUB_BITS 4 // Sub-intervalos por potência de 2 nos histogramas de tempos (2^4 = 16, erro <= 6%)
+#define TIMING_SUB_BUCKETS (1 << TIMING_SUB_BITS)
+#define TIMING_MAX_EXPONENT 39 // Maior duração distinguida: 2^40 ns (cerca de 18 minutos)
+#define TIMING_BUCKETS ((TIMING_MAX_EXPONENT - TIMING_SUB_BITS + 2) * TIMING_SUB_BUCKETS)
 
 // Nomes para os objetos de sincronização (memória partilhada e semáforos)
 #define SHM_NAME "/drone_simulation_shm"
@@ -34,17 +51,28 @@
 
 
 
+// Estrutura compacta para um movimento (linha) do script de um drone
+typedef struct
+{
+    double time; // Tempo associado ao movimento
+    double dx, dy, dz; // Deslocamento a aplicar à posição atual
+} ScriptStep;
+
 // Estrutura para armazenar o estado de um único drone
 typedef struct
 {
     int id;
     double x, y, z; // Coordenadas 3D
+    unsigned int seq; // Contador do seqlock da posição (ímpar durante uma escrita)
     pid_t pid; // ID do processo do drone
     double time; // Tempo associado a esta posição e step!
     int current_step; // Step atual do drone
     bool active; // Flag para indicar se o drone ainda está ativo
     bool completed; // Flag para indicar se o drone completou o seu script
+    bool scheduled; // Participa no passo que está a ser calculado (modo --pipeline)
     char script_file[256]; // Nome do ficheiro de script do drone
+    int script_offset; // Índice do primeiro movimento do drone na tabela de trajetória
+    int script_length; // Número de movimentos carregados na tabela de trajetória
 
 } Drone;
 
@@ -62,10 +90,122 @@ typedef struct
 
 } Collision;
 
-// Estrutura principal da memória partilhada que contém todo o estado da simulação
+// Posição calculada por um drone num passo, guardada num dos dois frames do modo --pipeline
+typedef struct
+{
+    double x, y, z;
+    double time;
+    int step; // Movimentos do script já aplicados
+} FramePosition;
+
+// Eventos do log assíncrono; cada um corresponde a uma mensagem do ciclo de simulação
+typedef enum
+{
+    LOG_STEP_BEGIN,
+    LOG_NO_ACTIVE_DRONES,
+    LOG_SIGNALING,
+    LOG_WAITING,
+    LOG_DRONES_DONE,
+    LOG_POSITIONS_HEADER,
+    LOG_POSITION,
+    LOG_POSITIONS_END,
+    LOG_DRONE_MOVED,
+    LOG_DRONE_EXITING,
+    LOG_CHECKING,
+    LOG_BROADPHASE_MISMATCH,
+    LOG_COLLISION_ALERT,
+    LOG_TERMINATING,
+    LOG_NO_COLLISIONS,
+    LOG_COLLISION_TOTAL,
+    LOG_COLLISION_LIMIT,
+    LOG_STEP_COMPLETED
+} LogEventType;
+
+// Evento binário compacto no anel de log; o texto só é formatado pela thread de escoamento
+typedef struct
+{
+    unsigned long sequence;           // Sequência da fila de Vyukov (indica se a célula está livre ou cheia)
+    LogEventType type;
+    int a, b, c;                      // IDs de drones, passos e contagens, conforme o tipo
+    double values[LOG_EVENT_VALUES];  // Posições e deslocamentos, conforme o tipo
+} LogEvent;
+
+// Cabeça do anel de log partilhado; as células ficam em log_offset no segmento
+typedef struct
+{
+    unsigned long head __attribute__((aligned(64))); // Próxima posição a reservar pelos produtores
+    unsigned long tail __attribute__((aligned(64))); // Próxima posição a consumir pela thread de escoamento
+    unsigned long mask;
+    unsigned int sleeping;                           // Futex: a thread de escoamento está a dormir
+    unsigned int stop;                               // Pedido de terminação da thread de escoamento
+} LogRing;
+
+// Fila MPSC sem locks com os índices das colisões registadas, consumida pela thread de relatório.
+// A capacidade (potência de 2 >= max_collisions) nunca se esgota: cada colisão entra uma única vez.
+typedef struct
+{
+    unsigned long head __attribute__((aligned(64))); // Próxima posição a reservar pelos produtores
+    unsigned long tail __attribute__((aligned(64))); // Próxima posição a consumir
+    unsigned long mask;
+} CollisionQueue;
+
+// Célula da fila de colisões
+typedef struct
+{
+    unsigned long sequence;  // pos + 1 quando a célula da posição pos está publicada
+    int index;               // Índice da colisão na tabela de colisões
+    unsigned long published; // Instante da publicação (ns), para medir a entrega ao relatório (--timing)
+} CollisionQueueCell;
+
+// Barreira de geração partilhada entre processos, baseada em futex. O coordenador incrementa
+// "generation" para iniciar um passo e os participantes incrementam "arrived"; o último a
+// chegar publica a geração em "done" e acorda o coordenador.
+typedef struct
+{
+    unsigned int generation; // Futex dos participantes: muda no início de cada passo
+    unsigned int arrived;    // Participantes que já concluíram a geração atual
+    unsigned int expected;   // Participantes esperados na geração atual
+    unsigned int done;       // Futex do coordenador: última geração concluída
+} StepBarrier;
+
+// Contadores de contenção da sincronização, atualizados atomicamente por todos os processos
+typedef struct
+{
+    unsigned long acquisitions;    // Aquisições do mutex global
+    unsigned long contended;       // Aquisições em que o mutex já estava ocupado
+    unsigned long seqlock_retries; // Leituras de posições repetidas por apanharem uma escrita
+} LockStats;
+
+// Fases medidas com --timing
+typedef enum
+{
+    TIMING_STEP,            // Passo completo do coordenador
+    TIMING_WAKE,            // Acordar os drones (sem_post, geração da barreira ou broadcast do pool)
+    TIMING_BARRIER,         // Espera pelos drones na barreira
+    TIMING_POSITIONS,       // Aceitação do frame (--pipeline) e listagem das posições
+    TIMING_COLLISION_CHECK, // Deteção e registo das colisões na thread de colisões
+    TIMING_COLLISION_WAIT,  // Espera do coordenador pelo fim da verificação de colisões
+    TIMING_REPORT_HANDOFF,  // Da publicação de uma colisão até a thread de relatório a retirar
+    TIMING_DRONE_FETCH,     // Drone: leitura do próximo movimento do script
+    TIMING_DRONE_PUBLISH,   // Drone: publicação da nova posição na memória partilhada
+    TIMING_PHASE_COUNT
+} TimingPhase;
+
+// Histograma log-linear (estilo HDR) das durações de uma fase, em nanossegundos: valores abaixo de
+// TIMING_SUB_BUCKETS têm um intervalo próprio e cada potência de 2 acima é dividida em
+// TIMING_SUB_BUCKETS intervalos iguais. Atualizado atomicamente pelo coordenador, threads e drones.
+typedef struct
+{
+    unsigned long count;
+    unsigned long total;                   // Soma das durações, para a média
+    unsigned long max;
+    unsigned long buckets[TIMING_BUCKETS];
+} TimingHistogram;
+
+// Estrutura principal da memória partilhada que contém todo o estado da simulação.
+// O segmento é dimensionado em tempo de execução: este cabeçalho é seguido pelos drones,
+// pela tabela de colisões (em collisions_offset) e pelos movimentos dos scripts (em scripts_offset).
 typedef struct {
-   Drone drones[MAX_DRONES];             
-    Collision collisions[MAX_COLLISIONS]; 
     int drone_count;                      
     int collision_count;                 
     int current_step;                     
@@ -88,21 +228,293 @@ typedef struct {
 
     bool collisions_checked;
 
+    int max_collisions;                   // Capacidade da tabela de colisões
+    size_t collisions_offset;             // Deslocamento (em bytes) da tabela de colisões no segmento
+    size_t scripts_offset;                // Deslocamento da tabela de trajetória (scripts lidos uma única vez)
+    size_t frames_offset;                 // Deslocamento dos dois frames de posições (modo --pipeline)
+    size_t log_offset;                    // Deslocamento das células do anel de log
+    size_t collision_queue_offset;        // Deslocamento das células da fila de colisões
+    size_t segment_size;                  // Tamanho total do segmento
+
+    StepBarrier step_barrier;             // Barreira futex usada com --sync=futex
+    LockStats lock_stats;                 // Contenção do mutex global e do seqlock das posições
+    int compute_step;                     // Passo que os drones estão a calcular (current_step sem --pipeline)
+    LogRing log_ring;                     // Anel de eventos de log escoado pelo coordenador
+    CollisionQueue collision_queue;       // Colisões novas para a thread de relatório
+    bool simulation_finished;             // O coordenador saiu do ciclo: o relatório pode ser gerado
+    TimingHistogram timing[TIMING_PHASE_COUNT]; // Durações de cada fase do passo (--timing)
+
+    Drone drones[];                       // Estado de cada drone (drone_count entradas)
+
 } SharedMemory;
 
+// Tabela de colisões registadas, a seguir aos drones no segmento
+static inline Collision *shm_collisions(SharedMemory *shm)
+{
+    return (Collision *)((char *)shm + shm->collisions_offset);
+}
+
+// Movimentos de todos os scripts, contíguos; cada drone começa em script_offset
+static inline ScriptStep *shm_script_steps(SharedMemory *shm)
+{
+    return (ScriptStep *)((char *)shm + shm->scripts_offset);
+}
+
+// Frame de posições de um passo: passos pares e ímpares alternam entre dois buffers
+static inline FramePosition *shm_frame(SharedMemory *shm, int step)
+{
+    return (FramePosition *)((char *)shm + shm->frames_offset) + (size_t)(step & 1) * shm->drone_count;
+}
+
+// Células do anel de log
+static inline LogEvent *shm_log_events(SharedMemory *shm)
+{
+    return (LogEvent *)((char *)shm + shm->log_offset);
+}
+
+// Células da fila de colisões
+static inline CollisionQueueCell *shm_collision_queue(SharedMemory *shm)
+{
+    return (CollisionQueueCell *)((char *)shm + shm->collision_queue_offset);
+}
+
+// Figura carregada para memória local antes de se criar a memória partilhada,
+// para que o segmento seja dimensionado com o número real de drones e de movimentos
+typedef struct
+{
+    Drone *drones;      // Estado inicial de cada drone (posição e script)
+    int drone_count;
+    int capacity;
+    ScriptStep *steps;  // Movimentos de todos os scripts, contíguos
+    int step_count;
+    int step_capacity;
+    int nlMax;          // Número de movimentos do maior script
+    int *script_table;        // Dispersão por nome de script: índice do primeiro drone que o usa (-1 = livre)
+    unsigned int script_mask; // Tamanho da tabela - 1 (potência de 2)
+} Figure;
+
+// Algoritmo de fase larga usado na deteção de colisões
+typedef enum
+{
+    BROADPHASE_BRUTE,   // Testa todos os pares i<j (O(n²))
+    BROADPHASE_GRID,    // Grelha uniforme (spatial hash) com células do tamanho de COLLISION_THRESHOLD
+    BROADPHASE_COMPARE  // Executa os dois e verifica se as listas de colisões coincidem
+} BroadphaseMode;
+
+// Forma de executar os drones em cada passo
+typedef enum
+{
+    EXECUTOR_PROCESSES, // Um processo (fork) por drone, acordado pelo seu semáforo
+    EXECUTOR_THREADS,   // Drones como tarefas de um pool de threads no processo coordenador
+    EXECUTOR_POOL       // K processos worker, cada um com uma fatia contígua de drones
+} ExecutorMode;
+
+// Verbosidade das mensagens do ciclo de simulação
+typedef enum
+{
+    LOG_LEVEL_QUIET,  // Nenhuma mensagem por passo (só avisos e o resumo final)
+    LOG_LEVEL_STEPS,  // Mensagens do coordenador e das colisões em cada passo
+    LOG_LEVEL_DRONES  // Também os movimentos e posições de cada drone (comportamento original)
+} LogLevel;
+
+// Mecanismo que acorda os drones e espera pelo fim de cada passo (executores com processos)
+typedef enum
+{
+    SYNC_FUTEX,      // Barreira de geração em memória partilhada: O(1) chamadas ao sistema por passo
+    SYNC_SEMAPHORES  // Um semáforo por drone/worker + semáforo de barreira: 2N chamadas por passo
+} SyncMode;
+
+// Forma como os drones publicam a posição em cada passo
+typedef enum
+{
+    PUBLISH_SEQLOCK, // Seqlock por drone: o escritor nunca bloqueia, o leitor obtém uma cópia consistente
+    PUBLISH_MUTEX    // Mutex global da memória partilhada (comportamento original)
+} PublishMode;
+
+// Implementação do kernel de distâncias da fase estreita
+typedef enum
+{
+    SIMD_AUTO,   // Escolhe a melhor implementação suportada pelo CPU
+    SIMD_AVX2,
+    SIMD_SSE2,
+    SIMD_SCALAR
+} SimdMode;
+
+// Configuração da simulação definida pelos argumentos da linha de comandos
+typedef struct
+{
+    BroadphaseMode broadphase;
+    SimdMode simd;
+    int max_steps;      // Limite de passos (0 = até ao fim do maior script)
+    int max_collisions; // Número de colisões que termina a simulação
+    ExecutorMode executor;
+    int workers;        // Threads/processos do executor (0 = número de núcleos)
+    SyncMode sync;
+    PublishMode publish;
+    bool pipeline;      // Drones calculam o passo k+1 enquanto o passo k é verificado
+    LogLevel log_level;
+    bool batch;             // Modo não interativo com várias figuras
+    int jobs;               // Figuras simuladas em simultâneo no modo --batch (0 = número de núcleos)
+    const char *report_dir; // Diretoria dos relatórios e do resumo do modo --batch
+    int detector_threads;   // Threads da deteção de colisões (1 = só a thread de colisões, 0 = núcleos)
+    bool timing;            // Mede a duração de cada fase do passo
+    const char *timing_file; // Ficheiro dos histogramas de tempos (NULL = secção no relatório)
+} SimulationConfig;
+
+// Resultado de uma figura enviado ao processo pai pelo pipe no modo --batch
+typedef struct
+{
+    int drones;
+    int steps;
+    int collisions;
+    double seconds;
+} BatchResult;
+
+// Figura em execução no modo --batch
+typedef struct
+{
+    pid_t pid;  // Processo que simula a figura (0 = posição livre)
+    int fd;     // Extremidade de leitura do pipe com o resultado
+    int index;  // Índice da figura na lista do lote
+} BatchJob;
+
+// Estado local de um drone: posição atual e próxima linha do script
+typedef struct
+{
+    double x, y, z;
+    double time; // Tempo do último movimento aplicado
+    int script_line_number;
+} DroneCursor;
+
+// Tarefa executada por todas as threads de um pool: task(arg, índice da thread, número de threads)
+typedef void (*PoolTask)(void *arg, int worker, int workers);
+
+struct WorkerPool;
+
+// Thread de um pool, com o seu índice
+typedef struct
+{
+    struct WorkerPool *pool;
+    int index;
+    pthread_t thread;
+} WorkerPoolThread;
+
+// Pool de threads de tamanho fixo; cada chamada a pool_run é uma nova "geração" de trabalho
+typedef struct WorkerPool
+{
+    WorkerPoolThread *threads;
+    int size;
+    pthread_mutex_t mutex;
+    pthread_cond_t start_cond;  // Acorda as threads para uma nova geração
+    pthread_cond_t done_cond;   // Sinaliza o coordenador quando a geração termina
+    unsigned long generation;
+    int pending;                // Threads que ainda não terminaram a geração atual
+    bool shutdown;
+    PoolTask task;
+    void *arg;
+} WorkerPool;
+
+// Par de drones cuja distância é inferior a COLLISION_THRESHOLD
+typedef struct
+{
+    int i, j; // Índices dos drones (i < j)
+    double distance;
+} CollisionPair;
+
+// Lista dinâmica de pares, mantida entre passos para evitar alocações
+typedef struct
+{
+    CollisionPair *pairs;
+    int count;
+    int capacity;
+} PairList;
+
+// Espelho em estrutura de arrays (SoA) das posições dos drones, usado na fase estreita.
+// Os drones inativos ficam com x = NaN, o que faz falhar qualquer comparação no kernel.
+typedef struct
+{
+    double *x, *y, *z;      // Coordenadas contíguas de todos os drones
+    unsigned char *active;  // Máscara de drones ativos
+    int *candidates;        // Buffer de saída do kernel (índices j abaixo do limiar)
+    int count;
+    int capacity;
+} PositionMirror;
+
+// Kernel que devolve os drones j em [j_begin, j_end) cuja distância² ao drone i é <= limit_sq
+typedef int (*DistanceKernel)(const PositionMirror *m, int i, int j_begin, int j_end, double limit_sq, int *out);
+
+// Grelha uniforme (spatial hash) reconstruída em cada passo pela thread de colisões
+typedef struct
+{
+    int *cell_head;       // Primeiro drone de cada entrada da tabela (-1 se vazia)
+    int *next;            // Próximo drone na mesma entrada da tabela
+    long long (*cell)[3]; // Coordenadas da célula de cada drone
+    unsigned int mask;    // Tamanho da tabela - 1 (potência de 2)
+    int capacity;         // Número de drones para o qual a grelha está alocada
+} SpatialGrid;
+
+// Fatia de linhas e buffers locais de uma thread de deteção
+typedef struct
+{
+    int row_begin, row_end; // Drones i tratados por esta thread: [row_begin, row_end)
+    PairList pairs;         // Pares encontrados, por ordem (i, j)
+    int *candidates;        // Buffer de saída do kernel de distâncias
+} DetectorSlice;
+
+// Dados partilhados pelas threads de deteção num passo
+typedef struct
+{
+    const PositionMirror *mirror;
+    const SpatialGrid *grid; // Grelha já construída, ou NULL para a força bruta
+} DetectorJob;
+
 // Variáveis globais
 SharedMemory *shared_mem = NULL;
+SimulationConfig config = { BROADPHASE_GRID, SIMD_AUTO, 0, DEFAULT_MAX_COLLISIONS, EXECUTOR_PROCESSES, 0, SYNC_FUTEX, PUBLISH_SEQLOCK, false, LOG_LEVEL_DRONES, false, 0, ".", 1, false, NULL };
+PositionMirror positions; // Espelho SoA preenchido pela thread de colisões em cada passo
+
+// Indica se as mensagens de um dado nível devem ser registadas
+static inline bool log_enabled(LogLevel level)
+{
+    return level <= config.log_level;
+}
+DistanceKernel distance_kernel = NULL; // Kernel escolhido por select_distance_kernel()
 
 int fd = -1;
 
+// Nomes dos objetos IPC e do relatório; no modo --batch cada figura usa o PID do seu processo como sufixo
+char ipc_suffix[32] = "";
+char shm_name[64] = SHM_NAME;
+char sem_barrier_name[64] = SEM_BARRIER_NAME;
+char sem_phase_name[64] = SEM_PHASE;
+char report_filename[PATH_MAX] = REPORT_FILENAME;
+
 // Semáforos
 sem_t *barrier_sem = NULL; // Semáforo de barreira
 sem_t *phase_sem = NULL; // Semaphore concrolo de fase
-sem_t *drone_sem[MAX_DRONES]; // semaphore para cada drone
+sem_t **drone_sem = NULL; // semaphore para cada drone
+int drone_sem_count = 0; // Número de semáforos de drone criados
 
 // Threads
 pthread_t collision_thread; // Handle da thread de deteção de colisão
 pthread_t report_thread;    // Handle da thread de geração de relatório
+pthread_t log_thread;       // Handle da thread que escoa o anel de log
+
+// Executor em modo "threads"
+WorkerPool drone_pool;             // Pool que executa os passos dos drones
+DroneCursor *drone_cursors = NULL; // Estado local de cada drone
+int next_drone_task = 0;           // Próximo drone a atribuir no passo atual (atómico)
+
+// Deteção de colisões com várias threads
+WorkerPool detector_pool;               // Pool das threads de deteção
+DetectorSlice *detector_slices = NULL;  // Estado de cada thread de deteção
+int detector_capacity = 0;              // Drones para os quais os buffers do kernel estão alocados
+unsigned long pair_checks = 0;          // Pares de drones cuja distância foi calculada (atómico)
+
+// Executor em modo "pool"
+int runner_count = 0;              // Processos ou threads que executam drones (= semáforos de drone)
+pid_t *pool_pids = NULL;           // PID de cada worker
+int *pool_slice_first = NULL;      // Fatia do worker w: drones [pool_slice_first[w], pool_slice_first[w + 1])
 
 
 // Declaração dos métodos
@@ -116,14 +528,73 @@ void *report_generation_thread(void *arg);
 void initialize_simulation(const char *figure_file);
 void start_simulation();
 
-void drone_process(int drone_id, const char* script_file);
+void drone_process(int drone_id);
+void pool_worker_process(int worker, int first, int last);
+int executor_runner_count(int drone_count);
+const char *executor_name();
+void drone_cursor_init(SharedMemory *shm, int drone_id, DroneCursor *cursor);
+void drone_step(SharedMemory *shm, int drone_id, DroneCursor *cursor);
+void start_drones();
+void run_drone_step(int active_count);
+void stop_drones();
+
+void step_barrier_run(StepBarrier *barrier, unsigned int expected);
+bool step_barrier_wait_start(SharedMemory *shm, unsigned int *generation);
+void step_barrier_arrive(StepBarrier *barrier, unsigned int generation);
+void step_barrier_release_all(StepBarrier *barrier);
+bool runner_wait_step(SharedMemory *shm, int runner, unsigned int *generation);
+void runner_finish_step(SharedMemory *shm, sem_t *barrier, unsigned int generation);
+
+void pool_init(WorkerPool *pool, int size);
+void pool_run(WorkerPool *pool, PoolTask task, void *arg);
+void pool_start(WorkerPool *pool, PoolTask task, void *arg);
+void pool_wait(WorkerPool *pool);
+void pool_destroy(WorkerPool *pool);
 void check_collisions();
+int schedule_drones();
+void collision_queue_push(int index);
+bool collision_queue_pop(int *index);
+bool collision_queue_ready();
+void log_event(LogLevel level, LogEventType type, int a, int b, int c, const double *values, int value_count);
+static inline unsigned long timing_start();
+unsigned long timing_record(TimingPhase phase, unsigned long start);
+void write_timing_stats(FILE *out);
+void* log_drain_thread(void* arg);
+void log_start();
+void log_flush();
+void log_stop();
+static void log_wake_drain(LogRing *ring);
+static inline bool drone_scheduled(const SharedMemory *shm, int drone_id);
+void commit_frame(int step);
+void find_collision_pairs(PairList *hits);
+void record_collisions(const PairList *hits);
+void shm_lock(SharedMemory *shm);
+void shm_unlock(SharedMemory *shm);
+void drone_publish_position(Drone *drone, double x, double y, double z, double time, int step);
+void drone_read_position(SharedMemory *shm, const Drone *drone, double *x, double *y, double *z);
+void broadphase_brute(const PositionMirror *m, PairList *list);
+void broadphase_grid(const PositionMirror *m, PairList *list);
+void broadphase_brute_rows(const PositionMirror *m, PairList *list, int row_begin, int row_end, int *candidates);
+void grid_build(SpatialGrid *grid, const PositionMirror *m);
+void grid_query_rows(const SpatialGrid *grid, const PositionMirror *m, PairList *list, int row_begin, int row_end);
+void broadphase_parallel(const PositionMirror *m, PairList *list, bool use_grid);
+void detector_start();
+void detector_stop();
+void update_position_mirror(PositionMirror *m);
+void select_distance_kernel();
+bool pair_lists_equal(const PairList *a, const PairList *b);
+int parse_options(int argc, char *argv[]);
+void set_ipc_suffix(const char *suffix);
+int run_batch(int argc, char *argv[]);
+void print_usage(const char *program);
 void cleanup_simulation();
 
-void setup_signal_handling();
+void setup_signal_handling(bool restart_syscalls);
 void handle_signal(int signum, siginfo_t *info, void *context);
 
-int count_lines(const char *filename);
+int load_script(const char *filename, Figure *figure);
+int load_figure(const char *figure_file, Figure *figure);
+void free_figure(Figure *figure);
 void generate_report();
 
 void terminate_drone();
@@ -133,8 +604,8 @@ void alldronesReady();
 void complete_all_active();
 int count_active_drones();
 
-void setup_shared_memory();
-void setup_semaphores();
+void setup_shared_memory(const Figure *figure);
+void setup_semaphores(int count);
 
 void clenup_shared_memory_semaphores();
 
@@ -162,13 +633,14 @@ void handle_signal(int signum, siginfo_t *info, void *context)
     }
 }
 
-// Configura os handlers de sinais utilizando sigaction 
-void setup_signal_handling()
+// Configura os handlers de sinais utilizando sigaction. Os processos filho não reiniciam as chamadas
+// de sistema, para que um SIGTERM interrompa o sem_wait em que estão bloqueados e possam terminar.
+void setup_signal_handling(bool restart_syscalls)
 {
     struct sigaction sa;
 
     memset(&sa, 0, sizeof(sa));
-    sa.sa_flags = SA_SIGINFO | SA_RESTART; // Usa sa_sigaction e reinicia chamadas de sistema interrompidas
+    sa.sa_flags = SA_SIGINFO | (restart_syscalls ? SA_RESTART : 0); // Usa sa_sigaction e (no pai) reinicia chamadas de sistema interrompidas
     sa.sa_sigaction = handle_signal;      // Define a função de tratamento
     sigemptyset(&sa.sa_mask);             // Não bloqueia outros sinais durante o tratamento
 
@@ -197,7 +669,18 @@ void setup_signal_handling()
 // Função principal do programa
 int main(int argc, char *argv[])
 {
-    
+    // Interpreta as opções; no modo --batch não há menu e podem ser passadas várias figuras
+    int first_arg = parse_options(argc, argv);
+    if (first_arg >= 0 && config.batch)
+    {
+        if (first_arg >= argc)
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+        return run_batch(argc - first_arg, argv + first_arg);
+    }
+
     int option;
     do
     {
@@ -220,28 +703,20 @@ int main(int argc, char *argv[])
         printf("Starting simulation...\n\n");
 
         // Verifica se o ficheiro da figura foi passado como argumento
-        if (argc != 2)
+        if (first_arg < 0 || argc - first_arg != 1)
         {
 
-            printf("Usage: %s <figure_file>\n", argv[0]);
+            print_usage(argv[0]);
 
             return 1;
         }
+        const char *figure_file = argv[first_arg];
 
-        // Configura a memória partilhada, os semáforos e os handlers de sinal
-        setup_shared_memory();
-        setup_semaphores();
-        setup_signal_handling();
-
-        // Armazena o nome do ficheiro da figura para o relatório
-        pthread_mutex_lock(&shared_mem->mutex);
-        strncpy(shared_mem->figure_filename, argv[1], sizeof(shared_mem->figure_filename) - 1);
-
-        shared_mem->figure_filename[sizeof(shared_mem->figure_filename) - 1] = '\0';
-        pthread_mutex_unlock(&shared_mem->mutex);
+        // Carrega a figura e configura a memória partilhada e os semáforos à medida dela
+        initialize_simulation(figure_file);
+        setup_signal_handling(true);
 
-        // Inicializa, executa e limpa a simulação
-        initialize_simulation(argv[1]);
+        // Executa e limpa a simulação
         start_simulation();
         cleanup_simulation();
 
@@ -254,35 +729,419 @@ int main(int argc, char *argv[])
     return 0;
 }
 
-// Configura e inicializa o segmento de memória partilhada
-void setup_shared_memory()
+// Acrescenta um sufixo aos nomes da memória partilhada e dos semáforos, para que várias
+// simulações (modo --batch) possam correr ao mesmo tempo sem partilhar objetos IPC
+void set_ipc_suffix(const char *suffix)
+{
+    snprintf(ipc_suffix, sizeof(ipc_suffix), "%s", suffix);
+    snprintf(shm_name, sizeof(shm_name), "%s%s", SHM_NAME, suffix);
+    snprintf(sem_barrier_name, sizeof(sem_barrier_name), "%s%s", SEM_BARRIER_NAME, suffix);
+    snprintf(sem_phase_name, sizeof(sem_phase_name), "%s%s", SEM_PHASE, suffix);
+}
+
+// Compara dois caminhos (para ordenar os ficheiros de uma diretoria)
+static int compare_paths(const void *a, const void *b)
+{
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+// Acrescenta um caminho à lista de figuras do lote
+static void batch_add_figure(char ***figures, int *count, int *capacity, const char *path)
+{
+    if (*count == *capacity) {
+        int new_capacity = *capacity ? *capacity * 2 : 16;
+        char **grown = realloc(*figures, new_capacity * sizeof(char *));
+        if (!grown) {
+            perror("Failed to allocate batch figure list");
+            exit(EXIT_FAILURE);
+        }
+        *figures = grown;
+        *capacity = new_capacity;
+    }
+    (*figures)[*count] = strdup(path);
+    if (!(*figures)[*count]) {
+        perror("Failed to allocate batch figure path");
+        exit(EXIT_FAILURE);
+    }
+    (*count)++;
+}
+
+// Expande os argumentos do lote: ficheiros são usados tal como estão; de uma diretoria são
+// usados, por ordem alfabética, os ficheiros cujo nome termina em "figure.txt"
+static int batch_collect_figures(int argc, char *argv[], char ***figures)
+{
+    int count = 0, capacity = 0;
+
+    for (int i = 0; i < argc; i++) {
+        struct stat st;
+        if (stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode)) {
+            DIR *dir = opendir(argv[i]);
+            if (!dir) {
+                perror(argv[i]);
+                continue;
+            }
+            int first = count;
+            struct dirent *entry;
+            while ((entry = readdir(dir)) != NULL) {
+                size_t len = strlen(entry->d_name);
+                if (len >= 10 && strcmp(entry->d_name + len - 10, "figure.txt") == 0) {
+                    char path[PATH_MAX];
+                    if (strcmp(argv[i], ".") == 0) {
+                        snprintf(path, sizeof(path), "%s", entry->d_name);
+                    } else {
+                        snprintf(path, sizeof(path), "%s/%s", argv[i], entry->d_name);
+                    }
+                    batch_add_figure(figures, &count, &capacity, path);
+                }
+            }
+            closedir(dir);
+            qsort(*figures + first, count - first, sizeof(char *), compare_paths);
+        } else {
+            batch_add_figure(figures, &count, &capacity, argv[i]);
+        }
+    }
+    return count;
+}
+
+// Constrói "<report_dir>/<nome da figura sem .txt><suffix>"
+static void batch_output_path(char *out, size_t size, const char *figure_file, const char *suffix)
+{
+    const char *base = strrchr(figure_file, '/');
+    base = base ? base + 1 : figure_file;
+    size_t len = strlen(base);
+    if (len > 4 && strcmp(base + len - 4, ".txt") == 0) len -= 4;
+    snprintf(out, size, "%s/%.*s%s", config.report_dir, (int)len, base, suffix);
+}
+
+// Processo filho do lote: simula uma figura com nomes IPC próprios, escreve o relatório da figura
+// e envia o resultado ao processo pai pelo pipe
+static void batch_run_figure(const char *figure_file, int result_fd)
+{
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "_%d", (int)getpid());
+    set_ipc_suffix(suffix);
+    batch_output_path(report_filename, sizeof(report_filename), figure_file, "_report.txt");
+
+    // A saída da simulação vai para um ficheiro por figura em vez de se misturar no terminal
+    char output_file[PATH_MAX];
+    batch_output_path(output_file, sizeof(output_file), figure_file, "_output.txt");
+    int out = open(output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out == -1) {
+        perror(output_file);
+        exit(EXIT_FAILURE);
+    }
+    dup2(out, STDOUT_FILENO);
+    close(out);
+
+    initialize_simulation(figure_file);
+    setup_signal_handling(true);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    start_simulation();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    BatchResult result;
+    result.drones = shared_mem->drone_count;
+    result.steps = shared_mem->current_step - 1;
+    result.collisions = shared_mem->collision_count;
+    result.seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    if (write(result_fd, &result, sizeof(result)) != (ssize_t)sizeof(result)) {
+        perror("Failed to send batch result");
+    }
+    close(result_fd);
+
+    cleanup_simulation();
+}
+
+// Modo --batch: simula todas as figuras, no máximo config.jobs ao mesmo tempo, escreve um relatório
+// por figura e um resumo TSV; devolve 0 se nenhuma figura falhou nem teve colisões
+int run_batch(int argc, char *argv[])
+{
+    char **figures = NULL;
+    int count = batch_collect_figures(argc, argv, &figures);
+    if (count == 0) {
+        fprintf(stderr, "No figures to simulate\n");
+        return 1;
+    }
+
+    if (mkdir(config.report_dir, 0755) == -1 && errno != EEXIST) {
+        perror(config.report_dir);
+        return 1;
+    }
+
+    int jobs = config.jobs > 0 ? config.jobs : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobs < 1) jobs = 1;
+    if (jobs > count) jobs = count;
+
+    BatchJob *running = calloc(jobs, sizeof(BatchJob));
+    BatchResult *results = calloc(count, sizeof(BatchResult));
+    const char **status = calloc(count, sizeof(char *));
+    if (!running || !results || !status) {
+        perror("Failed to allocate batch state");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Batch: %d figures, %d concurrent jobs, reports in %s\n", count, jobs, config.report_dir);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int next = 0, active = 0, done = 0;
+    int passed = 0, collided = 0, failed = 0;
+
+    while (next < count || active > 0) {
+        // Arranca figuras até ao limite de trabalhos em simultâneo
+        while (active < jobs && next < count) {
+            int fds[2];
+            if (pipe(fds) == -1) {
+                perror("pipe failed");
+                exit(EXIT_FAILURE);
+            }
+            fflush(stdout);
+            pid_t pid = fork();
+            if (pid == -1) {
+                perror("Fork failed!");
+                exit(EXIT_FAILURE);
+            } else if (pid == 0) {
+                close(fds[0]);
+                batch_run_figure(figures[next], fds[1]);
+                exit(EXIT_SUCCESS);
+            }
+            close(fds[1]);
+
+            for (int j = 0; j < jobs; j++) {
+                if (running[j].pid == 0) {
+                    running[j].pid = pid;
+                    running[j].fd = fds[0];
+                    running[j].index = next;
+                    break;
+                }
+            }
+            next++;
+            active++;
+        }
+
+        // Espera que uma figura termine e recolhe o seu resultado
+        int wstatus;
+        pid_t pid = waitpid(-1, &wstatus, 0);
+        if (pid == -1) {
+            if (errno == EINTR) continue;
+            perror("waitpid failed");
+            break;
+        }
+
+        for (int j = 0; j < jobs; j++) {
+            if (running[j].pid != pid) continue;
+
+            int index = running[j].index;
+            bool received = read(running[j].fd, &results[index], sizeof(BatchResult)) == (ssize_t)sizeof(BatchResult);
+            close(running[j].fd);
+            running[j].pid = 0;
+            active--;
+            done++;
+
+            if (!received || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0) {
+                status[index] = "failed";
+                failed++;
+            } else if (results[index].collisions > 0) {
+                status[index] = "collisions";
+                collided++;
+            } else {
+                status[index] = "passed";
+                passed++;
+            }
+            printf("[%d/%d] %s: %s (%d drones, %d steps, %d collisions, %.3f s)\n",
+                   done, count, figures[index], status[index], results[index].drones,
+                   results[index].steps, results[index].collisions, results[index].seconds);
+            break;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    // Resumo legível por máquina: uma linha por figura, separada por tabulações
+    char summary_file[PATH_MAX];
+    snprintf(summary_file, sizeof(summary_file), "%s/batch_summary.tsv", config.report_dir);
+    FILE *summary = fopen(summary_file, "w");
+    if (!summary) {
+        perror(summary_file);
+    } else {
+        fprintf(summary, "figure\tstatus\tdrones\tsteps\tcollisions\tseconds\treport\n");
+        for (int i = 0; i < count; i++) {
+            char report[PATH_MAX];
+            batch_output_path(report, sizeof(report), figures[i], "_report.txt");
+            fprintf(summary, "%s\t%s\t%d\t%d\t%d\t%.6f\t%s\n", figures[i], status[i] ? status[i] : "failed",
+                    results[i].drones, results[i].steps, results[i].collisions, results[i].seconds, report);
+        }
+        fclose(summary);
+    }
+
+    printf("\nBatch completed: %d passed, %d with collisions, %d failed\n", passed, collided, failed);
+    printf("Wall clock: %.3f s (%.2f figures/s)\n", elapsed, elapsed > 0 ? count / elapsed : 0.0);
+    printf("Summary written to %s\n", summary_file);
+
+    for (int i = 0; i < count; i++) free(figures[i]);
+    free(figures);
+    free(running);
+    free(results);
+    free(status);
+
+    return (collided == 0 && failed == 0) ? 0 : 1;
+}
+
+// Mostra a forma de utilização do programa e as opções disponíveis
+void print_usage(const char *program)
+{
+    printf("Usage: %s [options] <figure_file>\n", program);
+    printf("       %s --batch [options] <figure_file|directory>...\n", program);
+    printf("Options:\n");
+    printf("  --broadphase=brute|grid|compare  Collision broad phase (default: grid)\n");
+    printf("  --simd=auto|avx2|sse2|scalar     Distance kernel (default: auto)\n");
+    printf("  --max-steps=N                    Stop after N steps (default: longest script)\n");
+    printf("  --max-collisions=N               Collisions that stop the simulation (default: %d)\n", DEFAULT_MAX_COLLISIONS);
+    printf("  --executor=processes|threads|pool  One process per drone, a thread pool, or K worker\n");
+    printf("                                   processes with a slice of drones each (default: processes)\n");
+    printf("  --workers=N                      Threads/processes for threads and pool executors (default: cores)\n");
+    printf("  --sync=futex|sem                 Step barrier for process executors (default: futex)\n");
+    printf("  --publish=seqlock|mutex          How drones publish positions (default: seqlock)\n");
+    printf("  --pipeline                       Compute step k+1 while step k is collision-checked\n");
+    printf("  --log-level=quiet|steps|drones   Per-step output written by the log thread (default: drones)\n");
+    printf("  --quiet                          Same as --log-level=quiet\n");
+    printf("  --batch                          Simulate many figures without the menu; directories\n");
+    printf("                                   contribute their *figure.txt files\n");
+    printf("  --jobs=N                         Figures simulated concurrently in batch mode (default: cores)\n");
+    printf("  --detector-threads=N             Threads splitting collision detection (default: 1, 0 = cores)\n");
+    printf("  --report-dir=DIR                 Reports, outputs and batch_summary.tsv for batch mode (default: .)\n");
+    printf("  --timing[=FILE]                  Per-phase step timing histograms (p50/p99/max), appended to\n");
+    printf("                                   the report or written to FILE\n");
+}
+
+// Lê o valor inteiro de uma opção "--nome=N"; devolve true se a opção corresponder e for válida
+static bool parse_int_option(const char *arg, const char *prefix, int min_value, int *value)
+{
+    size_t len = strlen(prefix);
+    if (strncmp(arg, prefix, len) != 0) return false;
+
+    char *end;
+    long parsed = strtol(arg + len, &end, 10);
+    if (end == arg + len || *end != '\0' || parsed < min_value || parsed > 1000000000L) return false;
+
+    *value = (int)parsed;
+    return true;
+}
+
+// Interpreta as opções da linha de comandos; devolve o índice do primeiro argumento posicional
+int parse_options(int argc, char *argv[])
 {
+    int i;
+    for (i = 1; i < argc && strncmp(argv[i], "--", 2) == 0; i++)
+    {
+        if (strcmp(argv[i], "--broadphase=brute") == 0) {
+            config.broadphase = BROADPHASE_BRUTE;
+        } else if (strcmp(argv[i], "--broadphase=grid") == 0) {
+            config.broadphase = BROADPHASE_GRID;
+        } else if (strcmp(argv[i], "--broadphase=compare") == 0) {
+            config.broadphase = BROADPHASE_COMPARE;
+        } else if (strcmp(argv[i], "--simd=auto") == 0) {
+            config.simd = SIMD_AUTO;
+        } else if (strcmp(argv[i], "--simd=avx2") == 0) {
+            config.simd = SIMD_AVX2;
+        } else if (strcmp(argv[i], "--simd=sse2") == 0) {
+            config.simd = SIMD_SSE2;
+        } else if (strcmp(argv[i], "--simd=scalar") == 0) {
+            config.simd = SIMD_SCALAR;
+        } else if (parse_int_option(argv[i], "--max-steps=", 0, &config.max_steps)) {
+        } else if (parse_int_option(argv[i], "--max-collisions=", 1, &config.max_collisions)) {
+        } else if (strcmp(argv[i], "--executor=processes") == 0) {
+            config.executor = EXECUTOR_PROCESSES;
+        } else if (strcmp(argv[i], "--executor=threads") == 0) {
+            config.executor = EXECUTOR_THREADS;
+        } else if (strcmp(argv[i], "--executor=pool") == 0) {
+            config.executor = EXECUTOR_POOL;
+        } else if (parse_int_option(argv[i], "--workers=", 0, &config.workers)) {
+        } else if (strcmp(argv[i], "--sync=futex") == 0) {
+            config.sync = SYNC_FUTEX;
+        } else if (strcmp(argv[i], "--sync=sem") == 0) {
+            config.sync = SYNC_SEMAPHORES;
+        } else if (strcmp(argv[i], "--publish=seqlock") == 0) {
+            config.publish = PUBLISH_SEQLOCK;
+        } else if (strcmp(argv[i], "--publish=mutex") == 0) {
+            config.publish = PUBLISH_MUTEX;
+        } else if (strcmp(argv[i], "--pipeline") == 0) {
+            config.pipeline = true;
+        } else if (strcmp(argv[i], "--log-level=quiet") == 0 || strcmp(argv[i], "--quiet") == 0) {
+            config.log_level = LOG_LEVEL_QUIET;
+        } else if (strcmp(argv[i], "--log-level=steps") == 0) {
+            config.log_level = LOG_LEVEL_STEPS;
+        } else if (strcmp(argv[i], "--log-level=drones") == 0) {
+            config.log_level = LOG_LEVEL_DRONES;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            config.batch = true;
+        } else if (parse_int_option(argv[i], "--jobs=", 0, &config.jobs)) {
+        } else if (parse_int_option(argv[i], "--detector-threads=", 0, &config.detector_threads)) {
+        } else if (strncmp(argv[i], "--report-dir=", 13) == 0 && argv[i][13] != '\0') {
+            config.report_dir = argv[i] + 13;
+        } else if (strcmp(argv[i], "--timing") == 0) {
+            config.timing = true;
+        } else if (strncmp(argv[i], "--timing=", 9) == 0 && argv[i][9] != '\0') {
+            config.timing = true;
+            config.timing_file = argv[i] + 9;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return -1;
+        }
+    }
+    return i;
+}
+
+// Alinha um deslocamento no segmento de memória partilhada a uma linha de cache
+static size_t align_offset(size_t offset)
+{
+    return (offset + 63) & ~(size_t)63;
+}
+
+// Configura e inicializa o segmento de memória partilhada, dimensionado para a figura carregada:
+// cabeçalho + drones[drone_count] + colisões[max_collisions] + movimentos de todos os scripts
+void setup_shared_memory(const Figure *figure)
+{
+    // Calcula a disposição do segmento a partir do número real de drones e de movimentos
+    size_t collisions_offset = align_offset(sizeof(SharedMemory) + figure->drone_count * sizeof(Drone));
+    size_t scripts_offset = align_offset(collisions_offset + config.max_collisions * sizeof(Collision));
+    size_t frames_offset = align_offset(scripts_offset + figure->step_count * sizeof(ScriptStep));
+    size_t log_offset = align_offset(frames_offset + 2 * figure->drone_count * sizeof(FramePosition));
+    unsigned long queue_capacity = 1;
+    while (queue_capacity < (unsigned long)config.max_collisions) queue_capacity <<= 1;
+    size_t collision_queue_offset = align_offset(log_offset + LOG_RING_CAPACITY * sizeof(LogEvent));
+    size_t segment_size = collision_queue_offset + queue_capacity * sizeof(CollisionQueueCell);
+
     // Remove quaisquer instâncias antigas de memória partilhada ou semáforos com os mesmos nomes
-    shm_unlink(SHM_NAME);
-    sem_unlink(SEM_BARRIER_NAME);
+    shm_unlink(shm_name);
+    sem_unlink(sem_barrier_name);
 
     // Cria um novo segmento de memória partilhada
-    fd = shm_open(SHM_NAME, O_CREAT | O_EXCL | O_RDWR, 0644);
+    fd = shm_open(shm_name, O_CREAT | O_EXCL | O_RDWR, 0644);
     if (fd == -1) {
         perror("shm_open failed");
         exit(EXIT_FAILURE);
     }
 
     // Define o tamanho do segmento de memória partilhada
-    if (ftruncate(fd, sizeof(SharedMemory)) == -1) {
+    if (ftruncate(fd, segment_size) == -1) {
         perror("ftruncate failed");
         exit(EXIT_FAILURE);
     }
 
     // Mapeia o segmento de memória para o espaço de endereçamento do processo
-    shared_mem = mmap(NULL, sizeof(SharedMemory), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    shared_mem = mmap(NULL, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
     if (shared_mem == MAP_FAILED) {
         perror("mmap failed");
         exit(EXIT_FAILURE);
     }
 
     // Inicializa a memória partilhada com valores padrão
-    memset(shared_mem, 0, sizeof(SharedMemory));
+    memset(shared_mem, 0, segment_size);
     shared_mem->simulation_running = true;
     shared_mem->collision_detected = false;
     shared_mem->current_step = 0;
@@ -293,6 +1152,20 @@ void setup_shared_memory()
     shared_mem->threads_running = true;
     shared_mem->nlMax = 0;
     shared_mem->collisions_checked = false;
+    shared_mem->max_collisions = config.max_collisions;
+    shared_mem->collisions_offset = collisions_offset;
+    shared_mem->scripts_offset = scripts_offset;
+    shared_mem->frames_offset = frames_offset;
+    shared_mem->log_offset = log_offset;
+    shared_mem->collision_queue_offset = collision_queue_offset;
+    shared_mem->collision_queue.mask = queue_capacity - 1;
+
+    // Cada célula do anel começa livre para a posição com o mesmo índice
+    shared_mem->log_ring.mask = LOG_RING_CAPACITY - 1;
+    for (unsigned long i = 0; i < LOG_RING_CAPACITY; i++) {
+        shm_log_events(shared_mem)[i].sequence = i;
+    }
+    shared_mem->segment_size = segment_size;
 
 
     // Inicializa o mutex e as variáveis de condição para serem partilháveis entre processos
@@ -311,19 +1184,27 @@ void setup_shared_memory()
     pthread_condattr_destroy(&cond_attr);
 }
 
-// Configura e inicializa os semáforos nomeados
-void setup_semaphores()
+// Configura e inicializa os semáforos nomeados (um por drone da figura, ou por worker do pool)
+void setup_semaphores(int count)
 {
 
     // Cria o semáforo de barreira, inicializado a 0
-    barrier_sem = sem_open(SEM_BARRIER_NAME, O_CREAT | O_EXCL, 0644, 0);
+    barrier_sem = sem_open(sem_barrier_name, O_CREAT | O_EXCL, 0644, 0);
     // Cria o semáforo de fase, inicializado a 1
-    phase_sem = sem_open(SEM_PHASE, O_CREAT | O_EXCL, 0644, 1);
+    phase_sem = sem_open(sem_phase_name, O_CREAT | O_EXCL, 0644, 1);
+
+    drone_sem = calloc(count, sizeof(sem_t *));
+    if (!drone_sem) {
+        perror("Failed to allocate drone semaphores");
+        exit(EXIT_FAILURE);
+    }
+    drone_sem_count = count;
 
     // Cria um semáforo individual para cada drone, inicializados a 0
-    char sem_drone[32];
-    for (int i= 0; i < MAX_DRONES; i++){
-        sprintf(sem_drone, "/drone_sem_%d", i);
+    char sem_drone[64];
+    for (int i= 0; i < count; i++){
+        sprintf(sem_drone, "/drone_sem_%d%s", i, ipc_suffix);
+        sem_unlink(sem_drone);
     
         drone_sem[i]= sem_open(sem_drone, O_CREAT | O_EXCL, 0644, 0);
         if (drone_sem[i] == SEM_FAILED){
@@ -338,18 +1219,69 @@ void setup_semaphores()
     }
 }
 
-// Função para inicializar a simulação, lendo a configuração de um ficheiro.
-void initialize_simulation(const char *figure_file)
+// Dispersão FNV-1a do nome de um ficheiro de script
+static unsigned int script_name_hash(const char *name)
+{
+    unsigned int h = 2166136261u;
+    for (; *name; name++) {
+        h = (h ^ (unsigned char)*name) * 16777619u;
+    }
+    return h;
+}
+
+// Procura um drone já carregado que use o mesmo ficheiro de script; devolve -1 se não existir
+static int figure_find_script(const Figure *figure, const char *script_file)
+{
+    if (!figure->script_table) return -1;
+
+    for (unsigned int h = script_name_hash(script_file) & figure->script_mask; ; h = (h + 1) & figure->script_mask) {
+        int drone = figure->script_table[h];
+        if (drone < 0) return -1;
+        if (strcmp(figure->drones[drone].script_file, script_file) == 0) return drone;
+    }
+}
+
+// Regista o script do drone indicado na tabela de dispersão, duplicando-a quando fica meio cheia
+static int figure_add_script(Figure *figure, int drone)
 {
-    pthread_mutex_lock(&shared_mem->mutex);
+    unsigned int size = figure->script_table ? figure->script_mask + 1 : 0;
+
+    if (2 * (unsigned int)(drone + 1) > size) {
+        unsigned int new_size = size ? size * 2 : 64;
+        int *table = malloc(new_size * sizeof(int));
+        if (!table) {
+            perror("Failed to allocate script table");
+            return -1;
+        }
+        memset(table, -1, new_size * sizeof(int));
+
+        // Reinsere os scripts já registados (primeiros drones de cada ficheiro)
+        for (unsigned int k = 0; k < size; k++) {
+            int d = figure->script_table[k];
+            if (d < 0) continue;
+            unsigned int h = script_name_hash(figure->drones[d].script_file) & (new_size - 1);
+            while (table[h] >= 0) h = (h + 1) & (new_size - 1);
+            table[h] = d;
+        }
+        free(figure->script_table);
+        figure->script_table = table;
+        figure->script_mask = new_size - 1;
+    }
+
+    unsigned int h = script_name_hash(figure->drones[drone].script_file) & figure->script_mask;
+    while (figure->script_table[h] >= 0) h = (h + 1) & figure->script_mask;
+    figure->script_table[h] = drone;
+    return 0;
+}
 
+// Lê o ficheiro de figura e todos os scripts para memória local; devolve 0 em caso de sucesso
+int load_figure(const char *figure_file, Figure *figure)
+{
     FILE *file = fopen(figure_file, "r");
     if (!file)
     {
         perror("Error opening figure file!");
-        cleanup_simulation();
-
-        exit(EXIT_FAILURE);
+        return -1;
     }
 
     char line[256];
@@ -357,377 +1289,1845 @@ void initialize_simulation(const char *figure_file)
     double x, y, z;
 
     // Lê as posições iniciais dos drones e os ficheiros de script do ficheiro de figura
-    while (fgets(line, sizeof(line), file) && shared_mem->drone_count < MAX_DRONES)
+    while (fgets(line, sizeof(line), file))
     {
         // Interpreta cada linha para obter o nome do script e as coordenadas iniciais
-        if (sscanf(line, "%s %lf %lf %lf", script_file, &x, &y, &z) == 4)
-        {
-            shared_mem->drones[shared_mem->drone_count].id = shared_mem->drone_count;
-            shared_mem->drones[shared_mem->drone_count].x = x;
-            shared_mem->drones[shared_mem->drone_count].y = y;
-            shared_mem->drones[shared_mem->drone_count].z = z;
-            shared_mem->drones[shared_mem->drone_count].pid = 0;
-            shared_mem->drones[shared_mem->drone_count].time = 0.0;
-            shared_mem->drones[shared_mem->drone_count].current_step = 0;
-            shared_mem->drones[shared_mem->drone_count].active = true;
-            shared_mem->drones[shared_mem->drone_count].completed = false;
-            strcpy(shared_mem->drones[shared_mem->drone_count].script_file, script_file);
-            shared_mem->drone_count++;
-        }
-
-        // Conta as linhas no ficheiro de script para determinar a duração da simulação
-        int nL = count_lines(script_file);
-        if (nL >= shared_mem->nlMax)
+        if (sscanf(line, "%255s %lf %lf %lf", script_file, &x, &y, &z) == 4)
         {
-            shared_mem->nlMax = nL;
+            if (figure->drone_count == figure->capacity) {
+                int new_capacity = figure->capacity ? figure->capacity * 2 : 16;
+                Drone *drones = realloc(figure->drones, new_capacity * sizeof(Drone));
+                if (!drones) {
+                    perror("Failed to allocate drone table");
+                    fclose(file);
+                    return -1;
+                }
+                figure->drones = drones;
+                figure->capacity = new_capacity;
+            }
+
+            Drone *drone = &figure->drones[figure->drone_count];
+            memset(drone, 0, sizeof(Drone));
+            drone->id = figure->drone_count;
+            drone->x = x;
+            drone->y = y;
+            drone->z = z;
+            drone->pid = 0;
+            drone->time = 0.0;
+            drone->current_step = 0;
+            drone->active = true;
+            drone->completed = false;
+            strcpy(drone->script_file, script_file);
+
+            // Carrega o script para a tabela de trajetória (a duração da simulação é o maior script).
+            // Drones com o mesmo ficheiro de script partilham os movimentos, que só são lidos uma vez.
+            int shared = figure_find_script(figure, script_file);
+            int nL;
+            if (shared >= 0) {
+                drone->script_offset = figure->drones[shared].script_offset;
+                nL = figure->drones[shared].script_length;
+            } else {
+                drone->script_offset = figure->step_count;
+                nL = load_script(script_file, figure);
+                if (nL < 0)
+                {
+                    fclose(file);
+                    return -1;
+                }
+            }
+            drone->script_length = nL;
+            if (nL >= figure->nlMax)
+            {
+                figure->nlMax = nL;
+            }
+            if (shared < 0 && figure_add_script(figure, figure->drone_count) != 0) {
+                fclose(file);
+                return -1;
+            }
+            figure->drone_count++;
         }
     }
 
-    fclose(file);
+    fclose(file);
+
+    if (figure->drone_count == 0){
+        fprintf(stderr, "Error: No drones found in figure file!\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Liberta a memória local usada pela figura depois de copiada para a memória partilhada
+void free_figure(Figure *figure)
+{
+    free(figure->drones);
+    free(figure->steps);
+    free(figure->script_table);
+    memset(figure, 0, sizeof(Figure));
+}
+
+// Função para inicializar a simulação, lendo a configuração de um ficheiro.
+void initialize_simulation(const char *figure_file)
+{
+    Figure figure = {0};
+
+    if (load_figure(figure_file, &figure) != 0)
+    {
+        free_figure(&figure);
+
+        exit(EXIT_FAILURE);
+    }
+
+    // Só agora, com o tamanho real da figura, se cria a memória partilhada e os semáforos
+    setup_shared_memory(&figure);
+    setup_semaphores(config.sync == SYNC_SEMAPHORES ? executor_runner_count(figure.drone_count) : 0);
+
+    shm_lock(shared_mem);
+
+    // Copia os drones e a tabela de trajetória para a memória partilhada
+    memcpy(shared_mem->drones, figure.drones, figure.drone_count * sizeof(Drone));
+    memcpy(shm_script_steps(shared_mem), figure.steps, figure.step_count * sizeof(ScriptStep));
+    shared_mem->drone_count = figure.drone_count;
+    shared_mem->nlMax = figure.nlMax;
+
+    // Armazena o nome do ficheiro da figura para o relatório
+    strncpy(shared_mem->figure_filename, figure_file, sizeof(shared_mem->figure_filename) - 1);
+
+    shared_mem->figure_filename[sizeof(shared_mem->figure_filename) - 1] = '\0';
+        
+    shm_unlock(shared_mem);
+
+    free_figure(&figure);
+}
+
+// Função para iniciar e gerir o loop principal da simulação
+void start_simulation()
+{
+    printf("Starting simulation with %d drones\n", shared_mem->drone_count);
+    select_distance_kernel();
+    detector_start();
+
+    // Cria as threads de deteção de colisão e de geração de relatório
+    if (pthread_create(&collision_thread, NULL, collision_detection_thread, NULL) != 0) {
+        perror("Failed to create collision detection thread");
+        exit(EXIT_FAILURE);
+    }
+
+    if (pthread_create(&report_thread, NULL, report_generation_thread, NULL) != 0) {
+        perror("Failed to create report generation thread");
+        exit(EXIT_FAILURE);
+    }
+
+    // Arranca os drones (processos ou tarefas do pool de threads)
+    start_drones();
+
+    // A partir daqui as mensagens de cada passo passam pelo anel de log
+    log_start();
+
+    struct timespec loop_start, loop_end;
+    clock_gettime(CLOCK_MONOTONIC, &loop_start);
+
+    // Loop de simulação principal
+    shm_lock(shared_mem);
+    shared_mem->current_step = 1;
+    shm_unlock(shared_mem);
+
+    // O loop continua enquanto a simulação estiver ativa, dentro dos limites de passos e colisões
+    while (shared_mem->simulation_running && (config.max_steps == 0 || shared_mem->current_step <= config.max_steps) && 
+        shared_mem->current_step < shared_mem->nlMax + 1 && !shared_mem->termination_requested &&
+        shared_mem->collision_count < shared_mem->max_collisions){
+
+        log_event(LOG_LEVEL_STEPS, LOG_STEP_BEGIN, shared_mem->current_step, 0, 0, NULL, 0);
+        unsigned long step_start = timing_start();
+
+        int active_count = count_active_drones();
+        if (active_count == 0) {
+            log_event(LOG_LEVEL_STEPS, LOG_NO_ACTIVE_DRONES, 0, 0, 0, NULL, 0);
+            shm_lock(shared_mem);
+            shared_mem->simulation_running = false;
+            shm_unlock(shared_mem);
+            break;
+        }
+        //sem_wait(phase_sem);
+        // Reseta os contadores para o novo passo
+        shm_lock(shared_mem);
+        shared_mem->drones_completed_step = 0;
+        shared_mem->collisions_checked = false;
+        shm_unlock(shared_mem);
+
+        // Executa o passo em todos os drones ativos e espera que terminem. Com --pipeline o passo
+        // já foi calculado durante a verificação do anterior (exceto o primeiro)
+        if (!config.pipeline || shared_mem->compute_step < shared_mem->current_step) {
+            if (config.pipeline) {
+                active_count = schedule_drones();
+            }
+            shared_mem->compute_step = shared_mem->current_step;
+            log_event(LOG_LEVEL_STEPS, LOG_SIGNALING, active_count, shared_mem->current_step, 0, NULL, 0);
+            run_drone_step(active_count);
+        }
+
+        // Com --pipeline, as posições do frame deste passo passam a ser as posições dos drones
+        unsigned long phase_start = timing_start();
+        if (config.pipeline) {
+            commit_frame(shared_mem->current_step);
+        }
+
+        log_event(LOG_LEVEL_STEPS, LOG_DRONES_DONE, shared_mem->current_step, 0, 0, NULL, 0);
+
+        if (log_enabled(LOG_LEVEL_DRONES)) {
+            log_event(LOG_LEVEL_DRONES, LOG_POSITIONS_HEADER, shared_mem->current_step, 0, 0, NULL, 0);
+            for (int i = 0; i < shared_mem->drone_count; i++) {
+                if (shared_mem->drones[i].active || shared_mem->drones[i].completed) {
+                    double position[3] = { shared_mem->drones[i].x, shared_mem->drones[i].y, shared_mem->drones[i].z };
+                    int status = shared_mem->drones[i].active ? 0 : (shared_mem->drones[i].completed ? 1 : 2);
+                    log_event(LOG_LEVEL_DRONES, LOG_POSITION, i, status, 0, position, 3);
+                }
+            }
+            log_event(LOG_LEVEL_DRONES, LOG_POSITIONS_END, 0, 0, 0, NULL, 0);
+        }
+        timing_record(TIMING_POSITIONS, phase_start);
+
+        //check_collisions();
+
+        // Sinaliza a thread de deteção de colisão para começar a verificar
+        shm_lock(shared_mem);
+        shared_mem->step_in_progress = true;
+        pthread_cond_signal(&shared_mem->ready);
+        shm_unlock(shared_mem);
+
+        // Com --pipeline, os drones calculam o passo seguinte enquanto o detetor verifica este
+        int next_step = shared_mem->current_step + 1;
+        if (config.pipeline && (config.max_steps == 0 || next_step <= config.max_steps) &&
+            next_step <= shared_mem->nlMax && shared_mem->simulation_running && !shared_mem->termination_requested) {
+            int scheduled_count = schedule_drones();
+            if (scheduled_count > 0) {
+                shared_mem->compute_step = next_step;
+                log_event(LOG_LEVEL_STEPS, LOG_SIGNALING, scheduled_count, next_step, 0, NULL, 0);
+                run_drone_step(scheduled_count);
+            }
+        }
+
+        phase_start = timing_start();
+        shm_lock(shared_mem);
+        while (!shared_mem->collisions_checked && shared_mem->simulation_running) {
+            pthread_cond_wait(&shared_mem->ready, &shared_mem->mutex);
+        }
+        shm_unlock(shared_mem);
+        timing_record(TIMING_COLLISION_WAIT, phase_start);
+        if (shared_mem->collision_count >= shared_mem->max_collisions) {
+            // Verifica se o número máximo de colisões foi atingido
+            log_event(LOG_LEVEL_STEPS, LOG_COLLISION_LIMIT, shared_mem->collision_count, shared_mem->max_collisions, 0, NULL, 0);
+            shm_lock(shared_mem);
+            shared_mem->simulation_running = false;
+            shm_unlock(shared_mem);
+            terminate_drone_all();
+
+        }
+
+        log_event(LOG_LEVEL_STEPS, LOG_STEP_COMPLETED, shared_mem->current_step, 0, 0, NULL, 0);
+        // Avança para o próximo passo
+        shm_lock(shared_mem);
+        shared_mem->current_step++;
+        shared_mem->step_in_progress = false;
+        shm_unlock(shared_mem);
+        timing_record(TIMING_STEP, step_start);
+
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &loop_end);
+    log_flush();
+
+    // Se a simulação terminou sem exceder o limite de colisões, marca os drones ativos como completos
+    if(shared_mem->collision_count < shared_mem->max_collisions){
+        complete_all_active();
+    }
+    
+    // Sinaliza o fim da simulação para as threads
+    shared_mem->threads_running = false;
+    shared_mem->simulation_running = false;
+    stop_drones();
+
+    // Acorda quaisquer threads que possam estar a dormir para que possam terminar
+    shm_lock(shared_mem);
+    shared_mem->simulation_finished = true;
+    pthread_cond_broadcast(&shared_mem->collision_cond);
+    pthread_cond_broadcast(&shared_mem->step_cond);
+    pthread_cond_broadcast(&shared_mem->ready);
+    shm_unlock(shared_mem);
+
+    // Espera que as threads terminem a sua execução
+    pthread_join(collision_thread, NULL);
+    pthread_join(report_thread, NULL);
+    log_stop();
+    detector_stop();
+
+    // Com --timing=FILE os histogramas vão para um ficheiro próprio em vez do relatório
+    if (config.timing_file) {
+        FILE *timing_out = fopen(config.timing_file, "w");
+        if (!timing_out) {
+            perror("Error creating timing stats file");
+        } else {
+            write_timing_stats(timing_out);
+            fclose(timing_out);
+            printf("Step timing histograms written to %s\n", config.timing_file);
+        }
+    }
+
+    double elapsed = (loop_end.tv_sec - loop_start.tv_sec) + (loop_end.tv_nsec - loop_start.tv_nsec) / 1e9;
+    int steps = shared_mem->current_step - 1;
+    printf("\nSimulation completed after %d steps\n", steps);
+    printf("Total collisions: %d\n", shared_mem->collision_count);
+    printf("Step throughput (%s executor): %.1f steps/s (%.3f s)\n",
+           executor_name(),
+           elapsed > 0 ? steps / elapsed : 0.0, elapsed);
+
+    LockStats *stats = &shared_mem->lock_stats;
+    printf("Shared mutex (%s publish): %lu acquisitions, %lu contended (%.1f%%), %lu seqlock read retries\n",
+           config.publish == PUBLISH_SEQLOCK ? "seqlock" : "mutex",
+           stats->acquisitions, stats->contended,
+           stats->acquisitions ? 100.0 * stats->contended / stats->acquisitions : 0.0,
+           stats->seqlock_retries);
+
+    // Métricas usadas pelo "make bench": pares testados e pico de memória residente do coordenador
+    // (inclui as threads dos executores e da deteção; os processos dos drones contam à parte)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("Pair checks: %lu (%.0f per second)\n", pair_checks, elapsed > 0 ? pair_checks / elapsed : 0.0);
+    printf("Peak RSS: %ld KB\n", usage.ru_maxrss);
+}
+
+// Esta função é executada por cada processo filho criado para simular um drone.
+
+void drone_process(int drone_id){
+    // Cada processo drone configura o seu próprio handler de sinais
+    setup_signal_handling(false);
+
+    // Abre a memória partilhada existente
+    int drone_shm_fd = shm_open(shm_name, O_RDWR, 0);
+    if (drone_shm_fd == -1) {
+        perror("Child: shm_open failed");
+        exit(EXIT_FAILURE);
+    }
+
+    // Mapeia a memória partilhada para o seu espaço de endereçamento
+    SharedMemory *drone_shared_mem = mmap(NULL, shared_mem->segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, drone_shm_fd, 0);
+    if (drone_shared_mem == MAP_FAILED) {
+        perror("Child: mmap failed");
+        exit(EXIT_FAILURE);
+    }
+
+    // Abre o semáforo de barreira
+    sem_t *drone_barrier_sem = sem_open(sem_barrier_name, 0);
+
+    // Obtém a sua posição inicial da memória partilhada
+    DroneCursor cursor;
+    drone_cursor_init(drone_shared_mem, drone_id, &cursor);
+
+    printf("Drone %d ready to start at position (%.2f, %.2f, %.2f)\n", 
+           drone_id, cursor.x, cursor.y, cursor.z);
+    
+    // Geração da barreira futex já vista (lida antes de sinalizar que está pronto)
+    unsigned int generation = __atomic_load_n(&drone_shared_mem->step_barrier.generation, __ATOMIC_ACQUIRE);
+
+    // Sinaliza que este drone está pronto, incrementando o semáforo de barreira   
+    sem_post(drone_barrier_sem); 
+
+    // Loop principal do drone
+    while (drone_shared_mem->simulation_running && !shared_mem->termination_requested) {
+        
+        // Espera que o processo principal inicie o próximo passo
+        if (!runner_wait_step(drone_shared_mem, drone_id, &generation)) {
+            break;
+        }
+
+        // Verifica novamente as condições de terminação após ser acordado
+        if (!drone_shared_mem->simulation_running || shared_mem->termination_requested) {
+            runner_finish_step(drone_shared_mem, drone_barrier_sem, generation);
+            break;
+        }
+
+        // Verifica se este drone foi desativado (devido a uma colisão)
+        if (!drone_scheduled(drone_shared_mem, drone_id)) {
+            log_event(LOG_LEVEL_DRONES, LOG_DRONE_EXITING, drone_id, 0, 0, NULL, 0);
+            // Liberta a barreira (com futex, um drone inativo não conta para a geração)
+            if (config.sync == SYNC_SEMAPHORES) {
+                sem_post(drone_barrier_sem);
+            }
+            break;  // Sai do loop e termina o processo
+        }
+
+        // Aplica o próximo movimento e publica a nova posição
+        drone_step(drone_shared_mem, drone_id, &cursor);
+
+        // Sinaliza na barreira que completou o seu passo
+        runner_finish_step(drone_shared_mem, drone_barrier_sem, generation);
+        
+    }
+    // Limpa os recursos antes de terminar
+    munmap(drone_shared_mem, drone_shared_mem->segment_size);
+    close(drone_shm_fd);
+    sem_close(drone_barrier_sem);
+        
+    printf("Drone %d process exiting\n", drone_id); 
+}
+
+// Adquire o mutex global da memória partilhada, contando as aquisições em que já estava ocupado
+void shm_lock(SharedMemory *shm)
+{
+    if (pthread_mutex_trylock(&shm->mutex) != 0) {
+        __atomic_add_fetch(&shm->lock_stats.contended, 1, __ATOMIC_RELAXED);
+        pthread_mutex_lock(&shm->mutex);
+    }
+    __atomic_add_fetch(&shm->lock_stats.acquisitions, 1, __ATOMIC_RELAXED);
+}
+
+void shm_unlock(SharedMemory *shm)
+{
+    pthread_mutex_unlock(&shm->mutex);
+}
+
+// Publica a posição de um drone no seu slot. Só o próprio drone escreve no slot, por isso o
+// escritor nunca bloqueia: "seq" fica ímpar durante a escrita e par quando o valor é consistente.
+void drone_publish_position(Drone *drone, double x, double y, double z, double time, int step)
+{
+    unsigned int seq = __atomic_load_n(&drone->seq, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&drone->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store(&drone->x, &x, __ATOMIC_RELAXED);
+    __atomic_store(&drone->y, &y, __ATOMIC_RELAXED);
+    __atomic_store(&drone->z, &z, __ATOMIC_RELAXED);
+    __atomic_store(&drone->time, &time, __ATOMIC_RELAXED);
+    __atomic_store_n(&drone->current_step, step, __ATOMIC_RELAXED);
+    __atomic_store_n(&drone->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// Lê uma posição consistente do slot de um drone, repetindo se apanhar uma escrita a meio
+void drone_read_position(SharedMemory *shm, const Drone *drone, double *x, double *y, double *z)
+{
+    for (;;) {
+        unsigned int before = __atomic_load_n(&drone->seq, __ATOMIC_ACQUIRE);
+        if ((before & 1) == 0) {
+            __atomic_load(&drone->x, x, __ATOMIC_RELAXED);
+            __atomic_load(&drone->y, y, __ATOMIC_RELAXED);
+            __atomic_load(&drone->z, z, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&drone->seq, __ATOMIC_RELAXED) == before) {
+                return;
+            }
+        }
+        __atomic_add_fetch(&shm->lock_stats.seqlock_retries, 1, __ATOMIC_RELAXED);
+    }
+}
+
+// Indica se um drone participa no passo que está a ser calculado. Sem --pipeline é a flag "active";
+// com --pipeline é "scheduled", fixada pelo coordenador antes de acordar os drones, porque o detetor
+// pode desativar drones enquanto o passo seguinte já está a correr.
+static inline bool drone_scheduled(const SharedMemory *shm, int drone_id)
+{
+    return config.pipeline ? shm->drones[drone_id].scheduled : shm->drones[drone_id].active;
+}
+
+// Escreve a posição local do drone no frame do passo em cálculo (modo --pipeline)
+static void drone_write_frame(SharedMemory *shm, int drone_id, const DroneCursor *cursor)
+{
+    FramePosition *slot = &shm_frame(shm, shm->compute_step)[drone_id];
+    slot->x = cursor->x;
+    slot->y = cursor->y;
+    slot->z = cursor->z;
+    slot->time = cursor->time;
+    slot->step = cursor->script_line_number;
+}
+
+// Fixa o conjunto de drones que calcula o próximo passo (os ativos neste momento) e devolve quantos são
+int schedule_drones()
+{
+    int count = 0;
+    for (int i = 0; i < shared_mem->drone_count; i++) {
+        shared_mem->drones[i].scheduled = shared_mem->drones[i].active;
+        if (shared_mem->drones[i].scheduled) count++;
+    }
+    return count;
+}
+
+// Copia o frame de um passo para o estado dos drones, só para os drones que sobreviveram às
+// colisões dos passos anteriores; o que um drone já terminado calculou é descartado
+void commit_frame(int step)
+{
+    const FramePosition *frame = shm_frame(shared_mem, step);
+
+    for (int i = 0; i < shared_mem->drone_count; i++) {
+        if (shared_mem->drones[i].active) {
+            drone_publish_position(&shared_mem->drones[i], frame[i].x, frame[i].y, frame[i].z,
+                                   frame[i].time, frame[i].step);
+        }
+    }
+}
+
+// Inicializa o estado local de um drone a partir da sua posição inicial na memória partilhada
+void drone_cursor_init(SharedMemory *shm, int drone_id, DroneCursor *cursor)
+{
+    if (config.publish == PUBLISH_SEQLOCK) {
+        drone_read_position(shm, &shm->drones[drone_id], &cursor->x, &cursor->y, &cursor->z);
+    } else {
+        shm_lock(shm);
+        cursor->x = shm->drones[drone_id].x;
+        cursor->y = shm->drones[drone_id].y;
+        cursor->z = shm->drones[drone_id].z;
+        shm_unlock(shm);
+    }
+    cursor->time = shm->drones[drone_id].time;
+    cursor->script_line_number = 0;
+}
+
+// Executa um passo de um drone: aplica o próximo movimento do script e publica a nova posição.
+// É partilhada pelos processos drone e pelas threads do executor em modo "threads".
+void drone_step(SharedMemory *shm, int drone_id, DroneCursor *cursor)
+{
+    unsigned long phase_start = timing_start();
+
+    // Obtém o próximo movimento da tabela de trajetória já carregada (sem acesso a ficheiros)
+    if (cursor->script_line_number >= shm->drones[drone_id].script_length) {
+        // Script terminado: com --pipeline o drone mantém a posição também no frame deste passo
+        if (config.pipeline) {
+            drone_write_frame(shm, drone_id, cursor);
+        }
+        return;
+    }
+
+    const ScriptStep *step = &shm_script_steps(shm)[shm->drones[drone_id].script_offset + cursor->script_line_number];
+    double time = step->time, dx = step->dx, dy = step->dy, dz = step->dz;
+
+    // Atualiza posição somando os deltas à posição atual
+    cursor->x += dx;
+    cursor->y += dy;
+    cursor->z += dz;
+    cursor->time = time;
+    cursor->script_line_number++;
+    timing_record(TIMING_DRONE_FETCH, phase_start);
+
+    if (log_enabled(LOG_LEVEL_DRONES)) {
+        double move[6] = { dx, dy, dz, cursor->x, cursor->y, cursor->z };
+        log_event(LOG_LEVEL_DRONES, LOG_DRONE_MOVED, drone_id, shm->compute_step, 0, move, 6);
+    }
+
+    // Com --pipeline a posição vai para o frame do passo; o coordenador decide se é aceite
+    phase_start = timing_start();
+    if (config.pipeline) {
+        drone_write_frame(shm, drone_id, cursor);
+        timing_record(TIMING_DRONE_PUBLISH, phase_start);
+        return;
+    }
+
+    // Atualiza a sua posição na memória partilhada. Com o seqlock não é preciso o mutex global:
+    // "active" só é alterado pelo coordenador entre passos, enquanto os drones estão na barreira.
+    if (config.publish == PUBLISH_SEQLOCK) {
+        if (__atomic_load_n(&shm->drones[drone_id].active, __ATOMIC_ACQUIRE)) {
+            drone_publish_position(&shm->drones[drone_id], cursor->x, cursor->y, cursor->z,
+                                   time, cursor->script_line_number);
+        }
+        timing_record(TIMING_DRONE_PUBLISH, phase_start);
+        return;
+    }
+
+    shm_lock(shm);
+
+    if (shm->drones[drone_id].active){
+        shm->drones[drone_id].x = cursor->x;
+        shm->drones[drone_id].y = cursor->y;
+        shm->drones[drone_id].z = cursor->z;
+        shm->drones[drone_id].time = time;
+        shm->drones[drone_id].current_step = cursor->script_line_number;
+    } 
+    shm_unlock(shm);
+    timing_record(TIMING_DRONE_PUBLISH, phase_start);
+}
+
+// Ciclo de cada thread do pool: espera por uma nova geração de trabalho, executa-a e sinaliza o fim
+static void *pool_worker_thread(void *arg)
+{
+    WorkerPoolThread *self = arg;
+    WorkerPool *pool = self->pool;
+    unsigned long seen_generation = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (true) {
+        while (pool->generation == seen_generation && !pool->shutdown) {
+            pthread_cond_wait(&pool->start_cond, &pool->mutex);
+        }
+        if (pool->shutdown) break;
+        seen_generation = pool->generation;
+        PoolTask task = pool->task;
+        void *task_arg = pool->arg;
+        pthread_mutex_unlock(&pool->mutex);
+
+        task(task_arg, self->index, pool->size);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->pending == 0) {
+            pthread_cond_signal(&pool->done_cond);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+// Cria um pool com size threads (0 = número de núcleos disponíveis)
+void pool_init(WorkerPool *pool, int size)
+{
+    if (size <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        size = cores > 0 ? (int)cores : 1;
+    }
+
+    memset(pool, 0, sizeof(WorkerPool));
+    pool->size = size;
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->start_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+
+    pool->threads = calloc(size, sizeof(WorkerPoolThread));
+    if (!pool->threads) {
+        perror("Failed to allocate worker pool");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < size; i++) {
+        pool->threads[i].pool = pool;
+        pool->threads[i].index = i;
+        if (pthread_create(&pool->threads[i].thread, NULL, pool_worker_thread, &pool->threads[i]) != 0) {
+            perror("Failed to create worker thread");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+// Executa task(arg, worker, size) em todas as threads do pool e espera que todas terminem
+void pool_run(WorkerPool *pool, PoolTask task, void *arg)
+{
+    pool_start(pool, task, arg);
+    pool_wait(pool);
+}
+
+// Publica uma nova geração de trabalho e acorda as threads do pool, sem esperar por elas
+void pool_start(WorkerPool *pool, PoolTask task, void *arg)
+{
+    pthread_mutex_lock(&pool->mutex);
+    pool->task = task;
+    pool->arg = arg;
+    pool->pending = pool->size;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start_cond);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+// Espera que todas as threads do pool terminem a geração atual
+void pool_wait(WorkerPool *pool)
+{
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->done_cond, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+// Termina as threads do pool e liberta os seus recursos
+void pool_destroy(WorkerPool *pool)
+{
+    if (!pool->threads) return;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->start_cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->size; i++) {
+        pthread_join(pool->threads[i].thread, NULL);
+    }
+    free(pool->threads);
+    pool->threads = NULL;
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->start_cond);
+    pthread_cond_destroy(&pool->done_cond);
+}
+
+// Tarefa do executor em modo "threads": cada thread retira blocos de drones até não haver mais
+static void drone_step_task(void *arg, int worker, int workers)
+{
+    (void)arg;
+    (void)worker;
+    (void)workers;
+    int n = shared_mem->drone_count;
+
+    while (true) {
+        int first = __atomic_fetch_add(&next_drone_task, DRONE_TASK_CHUNK, __ATOMIC_RELAXED);
+        if (first >= n) break;
+        int last = first + DRONE_TASK_CHUNK < n ? first + DRONE_TASK_CHUNK : n;
+
+        for (int i = first; i < last; i++) {
+            if (drone_scheduled(shared_mem, i)) {
+                drone_step(shared_mem, i, &drone_cursors[i]);
+            }
+        }
+    }
+}
+
+// Espera num futex partilhado entre processos enquanto *addr == expected
+static int futex_wait(unsigned int *addr, unsigned int expected)
+{
+    return syscall(SYS_futex, addr, FUTEX_WAIT, expected, NULL, NULL, 0);
+}
+
+// Acorda até count processos/threads à espera no futex
+static int futex_wake(unsigned int *addr, int count)
+{
+    return syscall(SYS_futex, addr, FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
+// Coordenador: inicia uma nova geração com "expected" participantes e espera que todos cheguem.
+// Custa um FUTEX_WAKE para acordar todos e, no máximo, alguns FUTEX_WAIT para esperar pelo fim.
+void step_barrier_run(StepBarrier *barrier, unsigned int expected)
+{
+    if (expected == 0) return;
+
+    unsigned long phase_start = timing_start();
+    __atomic_store_n(&barrier->expected, expected, __ATOMIC_RELAXED);
+    __atomic_store_n(&barrier->arrived, 0, __ATOMIC_RELAXED);
+    unsigned int generation = __atomic_add_fetch(&barrier->generation, 1, __ATOMIC_RELEASE);
+    futex_wake(&barrier->generation, INT_MAX);
+    phase_start = timing_record(TIMING_WAKE, phase_start);
+
+    unsigned int done;
+    while ((done = __atomic_load_n(&barrier->done, __ATOMIC_ACQUIRE)) != generation) {
+        futex_wait(&barrier->done, done);
+    }
+    timing_record(TIMING_BARRIER, phase_start);
+}
+
+// Participante: espera que a geração mude em relação a *generation; devolve false se for interrompido
+// por um pedido de terminação ou pelo fim da simulação
+bool step_barrier_wait_start(SharedMemory *shm, unsigned int *generation)
+{
+    StepBarrier *barrier = &shm->step_barrier;
+    unsigned int current;
+
+    while ((current = __atomic_load_n(&barrier->generation, __ATOMIC_ACQUIRE)) == *generation) {
+        if (!shm->simulation_running || shm->termination_requested) return false;
+        futex_wait(&barrier->generation, current);
+    }
+    *generation = current;
+    return true;
+}
+
+// Participante: regista a chegada; o último a chegar acorda o coordenador
+void step_barrier_arrive(StepBarrier *barrier, unsigned int generation)
+{
+    unsigned int arrived = __atomic_add_fetch(&barrier->arrived, 1, __ATOMIC_ACQ_REL);
+    if (arrived == __atomic_load_n(&barrier->expected, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&barrier->done, generation, __ATOMIC_RELEASE);
+        futex_wake(&barrier->done, 1);
+    }
+}
+
+// Acorda todos os participantes no fim da simulação para que vejam simulation_running == false
+void step_barrier_release_all(StepBarrier *barrier)
+{
+    __atomic_add_fetch(&barrier->generation, 1, __ATOMIC_RELEASE);
+    futex_wake(&barrier->generation, INT_MAX);
+}
+
+// Espera pelo início do próximo passo (semáforo próprio ou barreira futex); devolve false se o
+// processo deve terminar
+bool runner_wait_step(SharedMemory *shm, int runner, unsigned int *generation)
+{
+    if (config.sync == SYNC_FUTEX) {
+        return step_barrier_wait_start(shm, generation);
+    }
+
+    // Espera pelo seu semáforo individual, que será libertado pelo processo principal no início de cada passo
+    while (sem_wait(drone_sem[runner]) == -1) {
+        if (errno != EINTR) {
+            perror("sem_wait failed");
+            return false;
+        }
+        if (shm->termination_requested) return false;
+    }
+    return true;
+}
+
+// Sinaliza o coordenador de que o passo foi concluído
+void runner_finish_step(SharedMemory *shm, sem_t *barrier, unsigned int generation)
+{
+    if (config.sync == SYNC_FUTEX) {
+        step_barrier_arrive(&shm->step_barrier, generation);
+    } else {
+        sem_post(barrier);
+    }
+}
+
+// Instante atual em nanossegundos (CLOCK_MONOTONIC, via vDSO); 0 quando --timing não está ativo,
+// para que as fases não medidas não paguem a leitura do relógio
+static inline unsigned long timing_start()
+{
+    if (!config.timing) return 0;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)now.tv_sec * 1000000000UL + (unsigned long)now.tv_nsec;
+}
+
+// Intervalo do histograma onde cai uma duração em nanossegundos
+static int timing_bucket(unsigned long ns)
+{
+    if (ns < TIMING_SUB_BUCKETS) return (int)ns;
+
+    int exponent = 63 - __builtin_clzl(ns);
+    if (exponent > TIMING_MAX_EXPONENT) return TIMING_BUCKETS - 1;
+    int shift = exponent - TIMING_SUB_BITS;
+    return (shift + 1) * TIMING_SUB_BUCKETS + (int)((ns >> shift) - TIMING_SUB_BUCKETS);
+}
+
+// Maior duração (ns) que cai no intervalo indicado
+static unsigned long timing_bucket_limit(int bucket)
+{
+    if (bucket < TIMING_SUB_BUCKETS) return (unsigned long)bucket;
+
+    int shift = bucket / TIMING_SUB_BUCKETS - 1;
+    unsigned long sub = (unsigned long)(bucket % TIMING_SUB_BUCKETS) + TIMING_SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+// Regista a duração de uma fase iniciada em start e devolve o instante atual, que pode servir de
+// início à fase seguinte. Só usa operações atómicas relaxadas: pode ser chamada por qualquer processo.
+unsigned long timing_record(TimingPhase phase, unsigned long start)
+{
+    if (!config.timing) return 0;
+
+    unsigned long now = timing_start();
+    unsigned long elapsed = now > start ? now - start : 0;
+    TimingHistogram *histogram = &shared_mem->timing[phase];
+
+    __atomic_add_fetch(&histogram->buckets[timing_bucket(elapsed)], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&histogram->count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&histogram->total, elapsed, __ATOMIC_RELAXED);
+    unsigned long max = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+    while (elapsed > max &&
+           !__atomic_compare_exchange_n(&histogram->max, &max, elapsed, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    return now;
+}
+
+// Percentil (0-100) de um histograma: limite superior do intervalo que o contém, sem passar do máximo
+static unsigned long timing_percentile(const TimingHistogram *histogram, double percentile)
+{
+    unsigned long rank = (unsigned long)ceil(histogram->count * percentile / 100.0);
+    if (rank == 0) rank = 1;
+
+    unsigned long seen = 0;
+    for (int b = 0; b < TIMING_BUCKETS; b++) {
+        seen += histogram->buckets[b];
+        if (seen >= rank) {
+            unsigned long limit = timing_bucket_limit(b);
+            return limit < histogram->max ? limit : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+// Escreve a tabela de tempos por fase (em microssegundos) no relatório ou no ficheiro de --timing
+void write_timing_stats(FILE *out)
+{
+    static const char *phase_names[TIMING_PHASE_COUNT] = {
+        "Step", "Drone wake", "Barrier wait", "Position dump", "Collision check",
+        "Collision wait", "Report handoff", "Drone script fetch", "Drone publish"
+    };
+
+    fprintf(out, "-------------------------------------------------------\n");
+    fprintf(out, "STEP TIMING (microseconds)\n\n");
+    fprintf(out, "%-20s %10s %10s %10s %10s %10s\n", "Phase", "Samples", "Mean", "p50", "p99", "Max");
+    for (int p = 0; p < TIMING_PHASE_COUNT; p++) {
+        const TimingHistogram *histogram = &shared_mem->timing[p];
+        if (histogram->count == 0) {
+            fprintf(out, "%-20s %10d %10s %10s %10s %10s\n", phase_names[p], 0, "-", "-", "-", "-");
+            continue;
+        }
+        fprintf(out, "%-20s %10lu %10.2f %10.2f %10.2f %10.2f\n", phase_names[p], histogram->count,
+                histogram->total / 1e3 / histogram->count,
+                timing_percentile(histogram, 50.0) / 1e3,
+                timing_percentile(histogram, 99.0) / 1e3,
+                histogram->max / 1e3);
+    }
+}
+
+// Acorda a thread de escoamento se estiver a dormir (uma leitura atómica no caso comum)
+static void log_wake_drain(LogRing *ring)
+{
+    // A barreira completa impede que a leitura de "sleeping" passe à frente da publicação do evento
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->sleeping, __ATOMIC_SEQ_CST)) {
+        __atomic_store_n(&ring->sleeping, 0, __ATOMIC_SEQ_CST);
+        futex_wake(&ring->sleeping, 1);
+    }
+}
+
+// Regista um evento no anel de log partilhado (fila limitada de Vyukov, sem locks). É usado pelo
+// coordenador, pelas threads e pelos processos dos drones; o texto só é formatado pela thread de
+// escoamento. Se o anel estiver cheio, o produtor cede o CPU até haver espaço (nada se perde).
+void log_event(LogLevel level, LogEventType type, int a, int b, int c, const double *values, int value_count)
+{
+    if (!log_enabled(level)) return;
+
+    LogRing *ring = &shared_mem->log_ring;
+    LogEvent *events = shm_log_events(shared_mem);
+    unsigned long pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    LogEvent *event;
+
+    for (;;) {
+        event = &events[pos & ring->mask];
+        unsigned long seq = __atomic_load_n(&event->sequence, __ATOMIC_ACQUIRE);
+        long diff = (long)(seq - pos);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Anel cheio: acorda a thread de escoamento e espera que liberte espaço
+            log_wake_drain(ring);
+            sched_yield();
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        } else {
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    event->type = type;
+    event->a = a;
+    event->b = b;
+    event->c = c;
+    for (int k = 0; k < value_count && k < LOG_EVENT_VALUES; k++) {
+        event->values[k] = values[k];
+    }
+    __atomic_store_n(&event->sequence, pos + 1, __ATOMIC_RELEASE);
+
+    log_wake_drain(ring);
+}
+
+// Indica se o próximo evento a consumir já foi completamente escrito
+static bool log_ready(LogRing *ring, LogEvent *events)
+{
+    unsigned long pos = ring->tail;
+    return __atomic_load_n(&events[pos & ring->mask].sequence, __ATOMIC_ACQUIRE) == pos + 1;
+}
+
+// Formata um evento com o mesmo texto que os printf originais
+static void log_format(const LogEvent *event)
+{
+    static const char *status_names[] = { "Active", "Completed", "Terminated" };
+    const double *v = event->values;
+
+    switch (event->type) {
+    case LOG_STEP_BEGIN:
+        printf("\n-SIMULATION STEP %d-\n", event->a);
+        break;
+    case LOG_NO_ACTIVE_DRONES:
+        printf("No active drones.\n");
+        break;
+    case LOG_SIGNALING:
+        printf("Signaling %d active drones to execute %d step\n", event->a, event->b);
+        break;
+    case LOG_WAITING:
+        printf("Waiting for all drones to complete %d step\n", event->a);
+        break;
+    case LOG_DRONES_DONE:
+        printf("All drones completed step %d\n", event->a);
+        break;
+    case LOG_POSITIONS_HEADER:
+        printf("\nAll Drone Positions at Step %d\n", event->a);
+        break;
+    case LOG_POSITION:
+        printf("Drone %d: position (%.2f, %.2f, %.2f) - %s\n", event->a, v[0], v[1], v[2], status_names[event->b]);
+        break;
+    case LOG_POSITIONS_END:
+        printf("\n");
+        break;
+    case LOG_DRONE_MOVED:
+        printf("Drone %d: Step %d - moved by (%.2f, %.2f, %.2f) to position (%.2f, %.2f, %.2f)\n",
+               event->a, event->b, v[0], v[1], v[2], v[3], v[4], v[5]);
+        break;
+    case LOG_DRONE_EXITING:
+        printf("Drone %d detected it was terminated due to collision, exiting process\n", event->a);
+        break;
+    case LOG_CHECKING:
+        printf("\nChecking for collisions\n");
+        break;
+    case LOG_BROADPHASE_MISMATCH:
+        printf("BROADPHASE MISMATCH at step %d: grid found %d pairs, brute force found %d\n",
+               event->a, event->b, event->c);
+        break;
+    case LOG_COLLISION_ALERT:
+        printf("COLLISION ALERT: Drones %d and %d are too close (%.2f meters)!\n\n", event->a, event->b, v[0]);
+        break;
+    case LOG_TERMINATING:
+        printf("Terminating drone %d \n", event->a);
+        break;
+    case LOG_NO_COLLISIONS:
+        printf("No collisions detected at step %d\n", event->a);
+        break;
+    case LOG_COLLISION_TOTAL:
+        printf("Total collisions so far: %d/%d\n", event->a, event->b);
+        break;
+    case LOG_COLLISION_LIMIT:
+        printf("\n*** COLLISION LIMIT EXCEEDED ***\n");
+        printf("Detected %d collisions (limit: %d). Stopping simulation.\n", event->a, event->b);
+        break;
+    case LOG_STEP_COMPLETED:
+        printf("Step %d completed.\n", event->a);
+        break;
+    }
+}
+
+// Thread do coordenador que escoa o anel de log para o stdout
+void* log_drain_thread(void* arg)
+{
+    (void)arg;
+    LogRing *ring = &shared_mem->log_ring;
+    LogEvent *events = shm_log_events(shared_mem);
+
+    for (;;) {
+        if (log_ready(ring, events)) {
+            unsigned long pos = ring->tail;
+            LogEvent *event = &events[pos & ring->mask];
+            log_format(event);
+            __atomic_store_n(&event->sequence, pos + ring->mask + 1, __ATOMIC_RELEASE);
+            __atomic_store_n(&ring->tail, pos + 1, __ATOMIC_RELEASE);
+            continue;
+        }
+
+        if (__atomic_load_n(&ring->stop, __ATOMIC_ACQUIRE)) break;
+
+        // Anel vazio: dorme no futex até um produtor o acordar
+        fflush(stdout);
+        __atomic_store_n(&ring->sleeping, 1, __ATOMIC_SEQ_CST);
+        if (!log_ready(ring, events) && !__atomic_load_n(&ring->stop, __ATOMIC_SEQ_CST)) {
+            futex_wait(&ring->sleeping, 1);
+        }
+        __atomic_store_n(&ring->sleeping, 0, __ATOMIC_SEQ_CST);
+    }
+
+    fflush(stdout);
+    return NULL;
+}
+
+// Arranca a thread de escoamento do log
+void log_start()
+{
+    if (pthread_create(&log_thread, NULL, log_drain_thread, NULL) != 0) {
+        perror("Failed to create log drain thread");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Espera até que todos os eventos já registados tenham sido escritos no stdout
+void log_flush()
+{
+    LogRing *ring = &shared_mem->log_ring;
+
+    while (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) != __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+        log_wake_drain(ring);
+        sched_yield();
+    }
+    fflush(stdout);
+}
+
+// Escoa os eventos pendentes e termina a thread de escoamento
+void log_stop()
+{
+    LogRing *ring = &shared_mem->log_ring;
+
+    log_flush();
+    __atomic_store_n(&ring->stop, 1, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&ring->sleeping, 0, __ATOMIC_SEQ_CST);
+    futex_wake(&ring->sleeping, 1);
+    pthread_join(log_thread, NULL);
+}
+
+// Processo de um worker do executor "pool": avança a fatia contígua [first, last) de drones em
+// cada passo e sinaliza a barreira uma única vez por fatia. Um drone terminado por colisão
+// deixa apenas de ser avançado (flag active), sem matar o processo que o executa.
+void pool_worker_process(int worker, int first, int last)
+{
+    // Cada worker configura o seu próprio handler de sinais
+    setup_signal_handling(false);
+
+    // Abre e mapeia a memória partilhada existente
+    int worker_shm_fd = shm_open(shm_name, O_RDWR, 0);
+    if (worker_shm_fd == -1) {
+        perror("Worker: shm_open failed");
+        exit(EXIT_FAILURE);
+    }
+
+    SharedMemory *worker_shared_mem = mmap(NULL, shared_mem->segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, worker_shm_fd, 0);
+    if (worker_shared_mem == MAP_FAILED) {
+        perror("Worker: mmap failed");
+        exit(EXIT_FAILURE);
+    }
+
+    sem_t *worker_barrier_sem = sem_open(sem_barrier_name, 0);
+
+    // Estado local dos drones da fatia
+    DroneCursor *cursors = calloc(last - first, sizeof(DroneCursor));
+    if (!cursors) {
+        perror("Worker: failed to allocate drone state");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = first; i < last; i++) {
+        drone_cursor_init(worker_shared_mem, i, &cursors[i - first]);
+    }
+
+    printf("Worker %d ready with drones %d-%d\n", worker, first, last - 1);
+
+    // Geração da barreira futex já vista (lida antes de sinalizar que está pronto)
+    unsigned int generation = __atomic_load_n(&worker_shared_mem->step_barrier.generation, __ATOMIC_ACQUIRE);
+
+    // Sinaliza que este worker está pronto
+    sem_post(worker_barrier_sem);
+
+    // Loop principal do worker
+    while (worker_shared_mem->simulation_running && !worker_shared_mem->termination_requested) {
+
+        // Espera que o processo principal inicie o próximo passo
+        if (!runner_wait_step(worker_shared_mem, worker, &generation)) {
+            break;
+        }
+
+        // Verifica novamente as condições de terminação após ser acordado
+        if (!worker_shared_mem->simulation_running || worker_shared_mem->termination_requested) {
+            runner_finish_step(worker_shared_mem, worker_barrier_sem, generation);
+            break;
+        }
+
+        // Avança todos os drones ainda ativos da fatia
+        for (int i = first; i < last; i++) {
+            if (drone_scheduled(worker_shared_mem, i)) {
+                drone_step(worker_shared_mem, i, &cursors[i - first]);
+            }
+        }
+
+        // Sinaliza na barreira que a fatia completou o passo
+        runner_finish_step(worker_shared_mem, worker_barrier_sem, generation);
+    }
+
+    // Limpa os recursos antes de terminar
+    free(cursors);
+    munmap(worker_shared_mem, worker_shared_mem->segment_size);
+    close(worker_shm_fd);
+    sem_close(worker_barrier_sem);
+
+    printf("Worker %d process exiting\n", worker);
+}
+
+// Verifica se a fatia de um worker do pool ainda tem drones ativos
+static bool pool_slice_active(int worker)
+{
+    for (int i = pool_slice_first[worker]; i < pool_slice_first[worker + 1]; i++) {
+        if (drone_scheduled(shared_mem, i)) return true;
+    }
+    return false;
+}
+
+// Número de processos/threads que executam drones (e de semáforos de drone necessários)
+int executor_runner_count(int drone_count)
+{
+    if (config.executor == EXECUTOR_PROCESSES) {
+        return drone_count;
+    }
+
+    int workers = config.workers;
+    if (workers <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cores > 0 ? (int)cores : 1;
+    }
+    return workers < drone_count ? workers : drone_count;
+}
+
+// Nome do executor escolhido, para mensagens
+const char *executor_name()
+{
+    switch (config.executor) {
+        case EXECUTOR_THREADS: return "threads";
+        case EXECUTOR_POOL: return "pool";
+        default: return "processes";
+    }
+}
+
+// Arranca os drones de acordo com o executor escolhido
+void start_drones()
+{
+    if (config.executor == EXECUTOR_THREADS) {
+        // Os drones são tarefas executadas por um pool de threads no próprio processo coordenador
+        drone_cursors = calloc(shared_mem->drone_count, sizeof(DroneCursor));
+        if (!drone_cursors) {
+            perror("Failed to allocate drone state");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < shared_mem->drone_count; i++) {
+            drone_cursor_init(shared_mem, i, &drone_cursors[i]);
+            printf("Drone %d ready to start at position (%.2f, %.2f, %.2f)\n", 
+                   i, drone_cursors[i].x, drone_cursors[i].y, drone_cursors[i].z);
+        }
+        pool_init(&drone_pool, config.workers);
+        printf("Started %d drones on %d worker threads\n", shared_mem->drone_count, drone_pool.size);
+        printf("\n");
+        return;
+    }
+
+    runner_count = executor_runner_count(shared_mem->drone_count);
+
+    if (config.executor == EXECUTOR_POOL) {
+        // Divide os drones em fatias contíguas, uma por worker
+        pool_pids = calloc(runner_count, sizeof(pid_t));
+        pool_slice_first = calloc(runner_count + 1, sizeof(int));
+        if (!pool_pids || !pool_slice_first) {
+            perror("Failed to allocate worker pool");
+            exit(EXIT_FAILURE);
+        }
+        for (int w = 0; w <= runner_count; w++) {
+            pool_slice_first[w] = (int)((long long)w * shared_mem->drone_count / runner_count);
+        }
+
+        for (int w = 0; w < runner_count; w++) {
+            // Esvazia o buffer de saída para que os processos filho não o herdem e repitam
+            fflush(stdout);
+            pid_t pid = fork();
+
+            if (pid == -1)
+            {
+                perror("Fork failed!");
+                exit(EXIT_FAILURE);
+            }
+            else if (pid == 0)
+            {
+                // Processo filho (worker)
+                pool_worker_process(w, pool_slice_first[w], pool_slice_first[w + 1]);
+                exit(EXIT_SUCCESS);
+            }
+            else
+            {
+                pool_pids[w] = pid;
+                printf("Started worker %d with PID %d for drones %d-%d\n",
+                       w, pid, pool_slice_first[w], pool_slice_first[w + 1] - 1);
+            }
+        }
+
+        printf("\n");
+
+        alldronesReady();
+        return;
+    }
+
+    // Bifurca (cria) um processo filho para cada drone
+    for (int i = 0; i < shared_mem->drone_count; i++){
+        // Esvazia o buffer de saída para que os processos filho não o herdem e repitam
+        fflush(stdout);
+        pid_t pid = fork();
+        
+        if (pid == -1)
+        {
+            perror("Fork failed!");
+            exit(EXIT_FAILURE);
+        }
+        else if (pid == 0)
+        {
+            // Processo filho (drone)
+            drone_process(i);
+            exit(EXIT_SUCCESS);
+        }
+        else
+        {
+            // Processo pai
+            shared_mem->drones[i].pid = pid;
+            printf("Started drone %d with PID %d using script %s\n", 
+                   i, pid, shared_mem->drones[i].script_file);
+        }
+    }
+
+    printf("\n");
+
+    alldronesReady();
+}
+
+// Executa um passo em todos os drones ativos e espera que todos o concluam
+void run_drone_step(int active_count)
+{
+    if (config.executor == EXECUTOR_THREADS) {
+        next_drone_task = 0;
+        unsigned long phase_start = timing_start();
+        pool_start(&drone_pool, drone_step_task, NULL);
+        phase_start = timing_record(TIMING_WAKE, phase_start);
+        pool_wait(&drone_pool);
+        timing_record(TIMING_BARRIER, phase_start);
+        return;
+    }
+
+    if (config.sync == SYNC_FUTEX) {
+        // Uma única geração da barreira acorda todos os participantes: os drones ativos
+        // (os terminados por colisão já saíram) ou todos os workers do pool
+        log_event(LOG_LEVEL_STEPS, LOG_WAITING, shared_mem->compute_step, 0, 0, NULL, 0);
+        step_barrier_run(&shared_mem->step_barrier,
+                         config.executor == EXECUTOR_POOL ? runner_count : active_count);
+        return;
+    }
+
+    unsigned long phase_start = timing_start();
+    if (config.executor == EXECUTOR_POOL) {
+        // Acorda apenas os workers que ainda têm drones ativos; cada um sinaliza a barreira uma vez
+        active_count = 0;
+        for (int w = 0; w < runner_count; w++) {
+            if (pool_slice_active(w)) {
+                sem_post(drone_sem[w]);
+                active_count++;
+            }
+        }
+    } else {
+        // Acorda cada drone ativo para executar o seu próximo movimento
+        for (int i = 0; i < shared_mem->drone_count; i++) {
+            if (drone_scheduled(shared_mem, i)){
+                sem_post(drone_sem[i]);
+            }
+        }
+    }
+
+    phase_start = timing_record(TIMING_WAKE, phase_start);
+
+    log_event(LOG_LEVEL_STEPS, LOG_WAITING, shared_mem->compute_step, 0, 0, NULL, 0);
+    
+    // Espera na barreira até que todos os drones ativos tenham completado o passo
+    for (int i = 0; i < active_count; i++) {
+        sem_wait(barrier_sem);
+    }
+    timing_record(TIMING_BARRIER, phase_start);
+}
+
+// Liberta os recursos do executor no fim da simulação
+void stop_drones()
+{
+    if (config.executor == EXECUTOR_THREADS) {
+        pool_destroy(&drone_pool);
+        free(drone_cursors);
+        drone_cursors = NULL;
+    } else if (config.sync == SYNC_FUTEX) {
+        // Os processos à espera na barreira acordam, veem o fim da simulação e terminam
+        step_barrier_release_all(&shared_mem->step_barrier);
+    }
+}
+
+// Acrescenta um par à lista, aumentando a capacidade quando necessário
+static void pair_list_push(PairList *list, int i, int j, double distance)
+{
+    if (list->count == list->capacity) {
+        int new_capacity = list->capacity ? list->capacity * 2 : 64;
+        CollisionPair *pairs = realloc(list->pairs, new_capacity * sizeof(CollisionPair));
+        if (!pairs) {
+            perror("Failed to allocate collision pair list");
+            exit(EXIT_FAILURE);
+        }
+        list->pairs = pairs;
+        list->capacity = new_capacity;
+    }
+    list->pairs[list->count].i = i;
+    list->pairs[list->count].j = j;
+    list->pairs[list->count].distance = distance;
+    list->count++;
+}
+
+// Ordena os pares por (i, j), a mesma ordem em que o ciclo O(n²) os encontra
+static int compare_pairs(const void *a, const void *b)
+{
+    const CollisionPair *pa = a, *pb = b;
+    if (pa->i != pb->i) return pa->i < pb->i ? -1 : 1;
+    if (pa->j != pb->j) return pa->j < pb->j ? -1 : 1;
+    return 0;
+}
+
+// Limite usado pelo kernel: ligeiramente acima de COLLISION_THRESHOLD² para que o filtro
+// nunca rejeite um par que o teste exato (sqrt(d²) < COLLISION_THRESHOLD) aceitaria
+#define KERNEL_LIMIT_SQ (COLLISION_THRESHOLD * COLLISION_THRESHOLD * (1.0 + 1e-12))
+
+// Copia as posições dos drones (AoS) para o espelho SoA, reservando memória quando necessário
+void update_position_mirror(PositionMirror *m)
+{
+    int n = shared_mem->drone_count;
+
+    if (m->capacity < n) {
+        free(m->x);
+        free(m->y);
+        free(m->z);
+        free(m->active);
+        free(m->candidates);
+        m->x = malloc(n * sizeof(double));
+        m->y = malloc(n * sizeof(double));
+        m->z = malloc(n * sizeof(double));
+        m->active = malloc(n * sizeof(unsigned char));
+        m->candidates = malloc(n * sizeof(int));
+        if (!m->x || !m->y || !m->z || !m->active || !m->candidates) {
+            perror("Failed to allocate position mirror");
+            exit(EXIT_FAILURE);
+        }
+        m->capacity = n;
+    }
+
+    for (int i = 0; i < n; i++) {
+        m->active[i] = shared_mem->drones[i].active;
+        if (config.publish == PUBLISH_SEQLOCK) {
+            drone_read_position(shared_mem, &shared_mem->drones[i], &m->x[i], &m->y[i], &m->z[i]);
+        } else {
+            m->x[i] = shared_mem->drones[i].x;
+            m->y[i] = shared_mem->drones[i].y;
+            m->z[i] = shared_mem->drones[i].z;
+        }
+        if (!m->active[i]) m->x[i] = NAN;
+    }
+    m->count = n;
+}
+
+// Distância² entre dois drones do espelho (a mesma ordem de operações em todos os kernels)
+static inline double mirror_distance_sq(const PositionMirror *m, int i, int j)
+{
+    double dx = m->x[i] - m->x[j];
+    double dy = m->y[i] - m->y[j];
+    double dz = m->z[i] - m->z[j];
+    return dx * dx + dy * dy + dz * dz;
+}
 
-    if (shared_mem->drone_count == 0){
-        fprintf(stderr, "Error: No drones found in figure file!\n");
-        exit(EXIT_FAILURE);
+// Teste exato entre dois drones; só calcula a raiz quadrada para os pares que passam o filtro
+static bool drones_too_close(const PositionMirror *m, int i, int j, double *distance)
+{
+    double distance_sq = mirror_distance_sq(m, i, j);
+    if (!(distance_sq <= KERNEL_LIMIT_SQ)) {
+        return false;
     }
-        
-    pthread_mutex_unlock(&shared_mem->mutex);
 
+    *distance = sqrt(distance_sq);
+
+    return *distance < COLLISION_THRESHOLD;
 }
 
-// Função para iniciar e gerir o loop principal da simulação
-void start_simulation()
+// Kernel escalar: usado em CPUs sem SIMD e para o resto de cada linha
+static int distance_kernel_scalar(const PositionMirror *m, int i, int j_begin, int j_end, double limit_sq, int *out)
 {
-    printf("Starting simulation with %d drones\n", shared_mem->drone_count);
-
-    // Cria as threads de deteção de colisão e de geração de relatório
-    if (pthread_create(&collision_thread, NULL, collision_detection_thread, NULL) != 0) {
-        perror("Failed to create collision detection thread");
-        exit(EXIT_FAILURE);
+    int count = 0;
+    for (int j = j_begin; j < j_end; j++) {
+        if (mirror_distance_sq(m, i, j) <= limit_sq) {
+            out[count++] = j;
+        }
     }
+    return count;
+}
 
-    if (pthread_create(&report_thread, NULL, report_generation_thread, NULL) != 0) {
-        perror("Failed to create report generation thread");
-        exit(EXIT_FAILURE);
+#ifdef HAVE_X86_SIMD
+// Kernel SSE2: compara 2 drones de cada vez
+__attribute__((target("sse2")))
+static int distance_kernel_sse2(const PositionMirror *m, int i, int j_begin, int j_end, double limit_sq, int *out)
+{
+    __m128d xi = _mm_set1_pd(m->x[i]);
+    __m128d yi = _mm_set1_pd(m->y[i]);
+    __m128d zi = _mm_set1_pd(m->z[i]);
+    __m128d limit = _mm_set1_pd(limit_sq);
+    int count = 0;
+    int j = j_begin;
+
+    for (; j + 2 <= j_end; j += 2) {
+        __m128d dx = _mm_sub_pd(xi, _mm_loadu_pd(&m->x[j]));
+        __m128d dy = _mm_sub_pd(yi, _mm_loadu_pd(&m->y[j]));
+        __m128d dz = _mm_sub_pd(zi, _mm_loadu_pd(&m->z[j]));
+        __m128d d2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz));
+        int hits = _mm_movemask_pd(_mm_cmple_pd(d2, limit));
+        while (hits) {
+            out[count++] = j + __builtin_ctz(hits);
+            hits &= hits - 1;
+        }
     }
+    return count + distance_kernel_scalar(m, i, j, j_end, limit_sq, out + count);
+}
 
-    // Bifurca (cria) um processo filho para cada drone
-    for (int i = 0; i < shared_mem->drone_count; i++){
-        pid_t pid = fork();
-        
-        if (pid == -1)
-        {
-            perror("Fork failed!");
-            exit(EXIT_FAILURE);
-        }
-        else if (pid == 0)
-        {
-            // Processo filho (drone)
-            drone_process(i, shared_mem->drones[i].script_file);
-            exit(EXIT_SUCCESS);
-        }
-        else
-        {
-            // Processo pai
-            shared_mem->drones[i].pid = pid;
-            printf("Started drone %d with PID %d using script %s\n", 
-                   i, pid, shared_mem->drones[i].script_file);
+// Kernel AVX2: compara 4 drones de cada vez
+__attribute__((target("avx2")))
+static int distance_kernel_avx2(const PositionMirror *m, int i, int j_begin, int j_end, double limit_sq, int *out)
+{
+    __m256d xi = _mm256_set1_pd(m->x[i]);
+    __m256d yi = _mm256_set1_pd(m->y[i]);
+    __m256d zi = _mm256_set1_pd(m->z[i]);
+    __m256d limit = _mm256_set1_pd(limit_sq);
+    int count = 0;
+    int j = j_begin;
+
+    for (; j + 4 <= j_end; j += 4) {
+        __m256d dx = _mm256_sub_pd(xi, _mm256_loadu_pd(&m->x[j]));
+        __m256d dy = _mm256_sub_pd(yi, _mm256_loadu_pd(&m->y[j]));
+        __m256d dz = _mm256_sub_pd(zi, _mm256_loadu_pd(&m->z[j]));
+        __m256d d2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)), _mm256_mul_pd(dz, dz));
+        int hits = _mm256_movemask_pd(_mm256_cmp_pd(d2, limit, _CMP_LE_OQ));
+        while (hits) {
+            out[count++] = j + __builtin_ctz(hits);
+            hits &= hits - 1;
         }
     }
+    return count + distance_kernel_scalar(m, i, j, j_end, limit_sq, out + count);
+}
+#endif
 
-    printf("\n");
+// Escolhe o kernel de distâncias consoante a opção --simd e as capacidades do CPU
+void select_distance_kernel()
+{
+    const char *name = "scalar";
+    distance_kernel = distance_kernel_scalar;
+
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    bool has_avx2 = __builtin_cpu_supports("avx2");
+    bool has_sse2 = __builtin_cpu_supports("sse2");
+
+    if ((config.simd == SIMD_AUTO || config.simd == SIMD_AVX2) && has_avx2) {
+        distance_kernel = distance_kernel_avx2;
+        name = "avx2";
+    } else if (config.simd != SIMD_SCALAR && has_sse2) {
+        distance_kernel = distance_kernel_sse2;
+        name = "sse2";
+    }
+#endif
 
-    alldronesReady();
+    if (config.simd == SIMD_AVX2 && strcmp(name, "avx2") != 0) {
+        printf("AVX2 not supported on this CPU, falling back to %s\n", name);
+    }
+    printf("Collision distance kernel: %s\n", name);
+}
 
-    // Loop de simulação principal
-    pthread_mutex_lock(&shared_mem->mutex);
-    shared_mem->current_step = 1;
-    pthread_mutex_unlock(&shared_mem->mutex);
+// Fase larga por força bruta: cada drone ativo é comparado com todos os drones seguintes
+// através do kernel vetorial, e só os candidatos passam pelo teste exato
+void broadphase_brute(const PositionMirror *m, PairList *list)
+{
+    list->count = 0;
+    broadphase_brute_rows(m, list, 0, m->count, m->candidates);
+}
 
-    // O loop continua enquanto a simulação estiver ativa, dentro dos limites de passos e colisões
-    while (shared_mem->simulation_running && shared_mem->current_step < MAX_STEPS && 
-        shared_mem->current_step < shared_mem->nlMax + 1 && !shared_mem->termination_requested &&
-        shared_mem->collision_count < MAX_COLLISIONS){
+// Força bruta restrita aos drones i em [row_begin, row_end), contra todos os j > i
+void broadphase_brute_rows(const PositionMirror *m, PairList *list, int row_begin, int row_end, int *candidates)
+{
+    unsigned long checks = 0;
 
-        printf("\n-SIMULATION STEP %d-\n", shared_mem->current_step);
+    for (int i = row_begin; i < row_end; i++){
 
-        int active_count = count_active_drones();
-        if (active_count == 0) {
-            printf("No active drones.\n");
-            pthread_mutex_lock(&shared_mem->mutex);
-            shared_mem->simulation_running = false;
-            pthread_mutex_unlock(&shared_mem->mutex);
-            break;
+        if (!m->active[i]){
+            continue; // Avança drones inativos
         }
-        //sem_wait(phase_sem);
-        // Reseta os contadores para o novo passo
-        pthread_mutex_lock(&shared_mem->mutex);
-        shared_mem->drones_completed_step = 0;
-        shared_mem->collisions_checked = false;
-        pthread_mutex_unlock(&shared_mem->mutex);
-        printf("Signaling %d active drones to execute %d step\n", active_count, shared_mem->current_step);
 
-        // Acorda cada drone ativo para executar o seu próximo movimento
-        for (int i = 0; i < shared_mem->drone_count; i++) {
-            if (shared_mem->drones[i].active){
-                sem_post(drone_sem[i]);
+        checks += m->count - i - 1;
+        int found = distance_kernel(m, i, i + 1, m->count, KERNEL_LIMIT_SQ, candidates);
+        for (int k = 0; k < found; k++){
+            int j = candidates[k];
+            double distance;
+            if (drones_too_close(m, i, j, &distance)) {
+                pair_list_push(list, i, j, distance);
             }
         }
+    }
+    __atomic_add_fetch(&pair_checks, checks, __ATOMIC_RELAXED);
+}
 
-        printf("Waiting for all drones to complete %d step\n", shared_mem->current_step);
-        
-        // Espera na barreira até que todos os drones ativos tenham completado o passo
-        for (int i = 0; i < active_count; i++) {
-            sem_wait(barrier_sem);
-        }
+// Função de dispersão das coordenadas de uma célula para uma entrada da tabela
+static unsigned int grid_hash(long long cx, long long cy, long long cz, unsigned int mask)
+{
+    unsigned long long h = (unsigned long long)cx * 73856093ULL
+                         ^ (unsigned long long)cy * 19349663ULL
+                         ^ (unsigned long long)cz * 83492791ULL;
+    return (unsigned int)(h ^ (h >> 32)) & mask;
+}
 
-        printf("All drones completed step %d\n", shared_mem->current_step);
+// Garante que a grelha tem espaço para drone_count drones (tabela com pelo menos 2x entradas)
+static void grid_reserve(SpatialGrid *grid, int drone_count)
+{
+    if (grid->capacity >= drone_count) return;
+
+    unsigned int table_size = 64;
+    while (table_size < 2u * (unsigned int)drone_count) table_size <<= 1;
+
+    free(grid->cell_head);
+    free(grid->next);
+    free(grid->cell);
+    grid->cell_head = malloc(table_size * sizeof(int));
+    grid->next = malloc(drone_count * sizeof(int));
+    grid->cell = malloc(drone_count * sizeof(*grid->cell));
+    if (!grid->cell_head || !grid->next || !grid->cell) {
+        perror("Failed to allocate spatial grid");
+        exit(EXIT_FAILURE);
+    }
+    grid->mask = table_size - 1;
+    grid->capacity = drone_count;
+}
 
-        printf("\nAll Drone Positions at Step %d\n", shared_mem->current_step);
-        for (int i = 0; i < shared_mem->drone_count; i++) {
-            if (shared_mem->drones[i].active || shared_mem->drones[i].completed) {
-                printf("Drone %d: position (%.2f, %.2f, %.2f) - %s\n", 
-                       i, shared_mem->drones[i].x, shared_mem->drones[i].y, shared_mem->drones[i].z,
-                       shared_mem->drones[i].active ? "Active" : 
-                       (shared_mem->drones[i].completed ? "Completed" : "Terminated"));
-            }
-        }
-        printf("\n");
+// Fase larga com grelha uniforme: só os drones na mesma célula ou em células vizinhas
+// chegam ao teste exato. Como a célula tem o tamanho do limiar, drones a mais de uma
+// célula de distância estão sempre a mais de COLLISION_THRESHOLD e podem ser ignorados.
+void broadphase_grid(const PositionMirror *m, PairList *list)
+{
+    static SpatialGrid grid;
 
-        //check_collisions();
+    list->count = 0;
+    grid_build(&grid, m);
+    grid_query_rows(&grid, m, list, 0, m->count);
 
-        // Sinaliza a thread de deteção de colisão para começar a verificar
-        pthread_mutex_lock(&shared_mem->mutex);
-        shared_mem->step_in_progress = true;
-        pthread_cond_signal(&shared_mem->ready);
-        while (!shared_mem->collisions_checked && shared_mem->simulation_running) {
-            pthread_cond_wait(&shared_mem->ready, &shared_mem->mutex);
-        }
-        pthread_mutex_unlock(&shared_mem->mutex);
-        if (shared_mem->collision_count >= MAX_COLLISIONS) {
-            // Verifica se o número máximo de colisões foi atingido
-            printf("\n*** COLLISION LIMIT EXCEEDED ***\n");
-            printf("Detected %d collisions (limit: %d). Stopping simulation.\n", 
-                   shared_mem->collision_count, MAX_COLLISIONS);
-            pthread_mutex_lock(&shared_mem->mutex);
-            shared_mem->simulation_running = false;
-            pthread_mutex_unlock(&shared_mem->mutex);
-            terminate_drone_all();
+    // Repõe a ordem (i, j) para que o registo de colisões seja igual ao da força bruta
+    qsort(list->pairs, list->count, sizeof(CollisionPair), compare_pairs);
+}
+
+// Reconstrói a grelha com as posições do passo atual
+void grid_build(SpatialGrid *grid, const PositionMirror *m)
+{
+    int n = m->count;
+
+    grid_reserve(grid, n);
+    memset(grid->cell_head, -1, (grid->mask + 1) * sizeof(int));
+
+    for (int i = 0; i < n; i++) {
+        if (!m->active[i]) continue;
+        grid->cell[i][0] = (long long)floor(m->x[i] / COLLISION_THRESHOLD);
+        grid->cell[i][1] = (long long)floor(m->y[i] / COLLISION_THRESHOLD);
+        grid->cell[i][2] = (long long)floor(m->z[i] / COLLISION_THRESHOLD);
+        unsigned int h = grid_hash(grid->cell[i][0], grid->cell[i][1], grid->cell[i][2], grid->mask);
+        grid->next[i] = grid->cell_head[h];
+        grid->cell_head[h] = i;
+    }
+}
+
+// Para cada drone i em [row_begin, row_end), testa os drones de índice superior nas 27 células vizinhas.
+// Só lê a grelha, por isso várias threads podem consultar fatias diferentes ao mesmo tempo.
+void grid_query_rows(const SpatialGrid *grid, const PositionMirror *m, PairList *list, int row_begin, int row_end)
+{
+    unsigned long checks = 0;
+
+    for (int i = row_begin; i < row_end; i++) {
+        if (!m->active[i]) continue;
+
+        for (int ox = -1; ox <= 1; ox++)
+        for (int oy = -1; oy <= 1; oy++)
+        for (int oz = -1; oz <= 1; oz++) {
+            long long cx = grid->cell[i][0] + ox;
+            long long cy = grid->cell[i][1] + oy;
+            long long cz = grid->cell[i][2] + oz;
+            unsigned int h = grid_hash(cx, cy, cz, grid->mask);
+
+            for (int j = grid->cell_head[h]; j != -1; j = grid->next[j]) {
+                // Ignora pares já vistos e drones de outra célula que partilham a entrada
+                if (j <= i || grid->cell[j][0] != cx || grid->cell[j][1] != cy || grid->cell[j][2] != cz) {
+                    continue;
+                }
 
+                checks++;
+                double distance;
+                if (drones_too_close(m, i, j, &distance)) {
+                    pair_list_push(list, i, j, distance);
+                }
+            }
         }
+    }
+    __atomic_add_fetch(&pair_checks, checks, __ATOMIC_RELAXED);
+}
 
-        printf("Step %d completed.\n", shared_mem->current_step);
-        // Avança para o próximo passo
-        pthread_mutex_lock(&shared_mem->mutex);
-        shared_mem->current_step++;
-        shared_mem->step_in_progress = false;
-        pthread_mutex_unlock(&shared_mem->mutex);
+// Distribui as linhas [0, n) pelas threads de deteção. Na força bruta a linha i tem n - 1 - i pares,
+// por isso as fronteiras seguem a área do triângulo; na grelha o trabalho por linha é uniforme.
+static void detector_partition(int n, bool triangular, int workers)
+{
+    double total = triangular ? (double)n * (n - 1) / 2.0 : (double)n;
+    double done = 0.0;
+    int row = 0;
+
+    for (int w = 0; w < workers; w++) {
+        detector_slices[w].row_begin = row;
+        double target = total * (w + 1) / workers;
+        while (row < n && (w == workers - 1 || done + (triangular ? n - 1 - row : 1) <= target)) {
+            done += triangular ? n - 1 - row : 1;
+            row++;
+        }
+        detector_slices[w].row_end = row;
+    }
+}
 
+// Tarefa de cada thread de deteção: procura os pares da sua fatia de linhas no seu buffer local
+static void detector_task(void *arg, int worker, int workers)
+{
+    (void)workers;
+    const DetectorJob *job = arg;
+    DetectorSlice *slice = &detector_slices[worker];
+
+    slice->pairs.count = 0;
+    if (job->grid) {
+        grid_query_rows(job->grid, job->mirror, &slice->pairs, slice->row_begin, slice->row_end);
+        qsort(slice->pairs.pairs, slice->pairs.count, sizeof(CollisionPair), compare_pairs);
+    } else {
+        broadphase_brute_rows(job->mirror, &slice->pairs, slice->row_begin, slice->row_end, slice->candidates);
     }
+}
 
-    // Se a simulação terminou sem exceder o limite de colisões, marca os drones ativos como completos
-    if(shared_mem->collision_count < MAX_COLLISIONS){
-        complete_all_active();
+// Fase larga dividida pelo pool de deteção. Cada thread trata linhas contíguas, por isso juntar os
+// buffers locais pela ordem das threads dá exatamente a ordem (i, j) do caminho com uma só thread.
+void broadphase_parallel(const PositionMirror *m, PairList *list, bool use_grid)
+{
+    static SpatialGrid grid;
+    int workers = detector_pool.size;
+    int n = m->count;
+
+    if (detector_capacity < n) {
+        for (int w = 0; w < workers; w++) {
+            free(detector_slices[w].candidates);
+            detector_slices[w].candidates = malloc(n * sizeof(int));
+            if (!detector_slices[w].candidates) {
+                perror("Failed to allocate detector buffers");
+                exit(EXIT_FAILURE);
+            }
+        }
+        detector_capacity = n;
     }
-    
-    // Sinaliza o fim da simulação para as threads
-    shared_mem->threads_running = false;
-    shared_mem->simulation_running = false;
 
-    // Acorda quaisquer threads que possam estar a dormir para que possam terminar
-    pthread_mutex_lock(&shared_mem->mutex);
-    pthread_cond_broadcast(&shared_mem->collision_cond);
-    pthread_cond_broadcast(&shared_mem->step_cond);
-    pthread_cond_broadcast(&shared_mem->ready);
-    pthread_mutex_unlock(&shared_mem->mutex);
+    if (use_grid) {
+        grid_build(&grid, m);
+    }
+    detector_partition(n, !use_grid, workers);
 
-    // Espera que as threads terminem a sua execução
-    pthread_join(collision_thread, NULL);
-    pthread_join(report_thread, NULL);
+    DetectorJob job = { m, use_grid ? &grid : NULL };
+    pool_run(&detector_pool, detector_task, &job);
 
-    printf("\nSimulation completed after %d steps\n", shared_mem->current_step - 1);
-    printf("Total collisions: %d\n", shared_mem->collision_count);
+    list->count = 0;
+    for (int w = 0; w < workers; w++) {
+        for (int k = 0; k < detector_slices[w].pairs.count; k++) {
+            const CollisionPair *pair = &detector_slices[w].pairs.pairs[k];
+            pair_list_push(list, pair->i, pair->j, pair->distance);
+        }
+    }
 }
 
-// Esta função é executada por cada processo filho criado para simular um drone.
-
-void drone_process(int drone_id, const char *script_file){
-    // Cada processo drone configura o seu próprio handler de sinais
-    setup_signal_handling();
+// Arranca o pool de threads de deteção (--detector-threads > 1)
+void detector_start()
+{
+    if (config.detector_threads == 1) return;
 
-    // Abre a memória partilhada existente
-    int drone_shm_fd = shm_open(SHM_NAME, O_RDWR, 0);
-    if (drone_shm_fd == -1) {
-        perror("Child: shm_open failed");
+    pool_init(&detector_pool, config.detector_threads);
+    detector_slices = calloc(detector_pool.size, sizeof(DetectorSlice));
+    if (!detector_slices) {
+        perror("Failed to allocate detector slices");
         exit(EXIT_FAILURE);
     }
+    printf("Collision detection split across %d threads\n", detector_pool.size);
+}
 
-    // Mapeia a memória partilhada para o seu espaço de endereçamento
-    SharedMemory *drone_shared_mem = mmap(NULL, sizeof(SharedMemory), PROT_READ | PROT_WRITE, MAP_SHARED, drone_shm_fd, 0);
-    if (drone_shared_mem == MAP_FAILED) {
-        perror("Child: mmap failed");
-        exit(EXIT_FAILURE);
+// Termina o pool de deteção e liberta os buffers locais
+void detector_stop()
+{
+    if (!detector_slices) return;
+
+    for (int w = 0; w < detector_pool.size; w++) {
+        free(detector_slices[w].pairs.pairs);
+        free(detector_slices[w].candidates);
     }
+    free(detector_slices);
+    detector_slices = NULL;
+    detector_capacity = 0;
+    pool_destroy(&detector_pool);
+}
 
-    // Abre o semáforo de barreira
-    sem_t *drone_barrier_sem = sem_open(SEM_BARRIER_NAME, 0);
+// Verifica se duas listas de pares são idênticas
+bool pair_lists_equal(const PairList *a, const PairList *b)
+{
+    if (a->count != b->count) return false;
+    for (int k = 0; k < a->count; k++) {
+        if (a->pairs[k].i != b->pairs[k].i || a->pairs[k].j != b->pairs[k].j) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    // Obtém a sua posição inicial da memória partilhada
-    pthread_mutex_lock(&drone_shared_mem->mutex);
-    double current_pos_x = drone_shared_mem->drones[drone_id].x;
-    double current_pos_y = drone_shared_mem->drones[drone_id].y;
-    double current_pos_z = drone_shared_mem->drones[drone_id].z;
-    pthread_mutex_unlock(&drone_shared_mem->mutex);
-    int script_line_number = 0; 
+// Função para verificar e processar colisões entre drones num determinado instante de tempo da simulação
+void check_collisions()
+{
+    static PairList hits;
 
-    printf("Drone %d ready to start at position (%.2f, %.2f, %.2f)\n", 
-           drone_id, current_pos_x, current_pos_y, current_pos_z);
-    
-    // Sinaliza que este drone está pronto, incrementando o semáforo de barreira   
-    sem_post(drone_barrier_sem); 
+    find_collision_pairs(&hits);
+    record_collisions(&hits);
+}
 
-    // Loop principal do drone
-    while (drone_shared_mem->simulation_running && !shared_mem->termination_requested) {
-        
-        // Espera pelo seu semáforo individual, que será libertado pelo processo principal no início de cada passo
-        if (sem_wait(drone_sem[drone_id]) == -1) {
-            if (errno == EINTR) {
-                if (shared_mem->termination_requested) break;
-                continue;
-            }
-            perror("sem_wait failed");
-            break;
-        }
+// Deteção: obtém os pares de drones ativos demasiado próximos a partir de uma cópia das posições.
+// Não altera o estado partilhado, por isso pode correr sem o mutex global quando se usa o seqlock.
+void find_collision_pairs(PairList *hits)
+{
+    static PairList reference;
 
-        // Verifica novamente as condições de terminação após ser acordado
-        if (!drone_shared_mem->simulation_running || shared_mem->termination_requested) {
-            sem_post(drone_barrier_sem);
-            break;
-        }
+    log_event(LOG_LEVEL_STEPS, LOG_CHECKING, 0, 0, 0, NULL, 0);
 
-        // Verifica se este drone foi desativado (devido a uma colisão)
-        if (!drone_shared_mem->drones[drone_id].active) {
-            printf("Drone %d detected it was terminated due to collision, exiting process\n", drone_id);
-            sem_post(drone_barrier_sem); // Liberta a barreira
-            break;  // Sai do loop e termina o processo
-        }
+    // Atualiza o espelho SoA com as posições deste passo
+    update_position_mirror(&positions);
 
-        // Abre o seu ficheiro de script para ler o próximo movimento
-        FILE *file = fopen(script_file, "r");
-        if (!file){
-            perror("Error opening drone script file!");
-            exit(EXIT_FAILURE);
-            break;
+    // Fase larga: obtém os pares de drones ativos demasiado próximos, por ordem (i, j)
+    // Com --detector-threads > 1 as linhas são divididas pelo pool de deteção
+    if (config.broadphase == BROADPHASE_BRUTE) {
+        if (detector_slices) {
+            broadphase_parallel(&positions, hits, false);
+        } else {
+            broadphase_brute(&positions, hits);
         }
-
-        char line[256];
-        char line_found = false;
-        int current_line = 0;
-
-        // Lê o ficheiro linha por linha até encontrar a linha correspondente ao passo atual
-        while (fgets(line, sizeof(line), file)) {
-                if (current_line == script_line_number) {
-                    line_found = true;
-                    break;
-                }
-                current_line++;
+    } else {
+        if (detector_slices) {
+            broadphase_parallel(&positions, hits, true);
+        } else {
+            broadphase_grid(&positions, hits);
         }
-        fclose(file);
-        if(line_found){
-            double time, dx, dy, dz;
-            if (sscanf(line, "%lf %lf %lf %lf", &time, &dx, &dy, &dz) == 4)
-            {
-                // Atualiza posição somando os deltas à posição atual
-                current_pos_x += dx;
-                current_pos_y += dy;
-                current_pos_z += dz;
-                script_line_number++;
-
-                printf("Drone %d: Step %d - moved by (%.2f, %.2f, %.2f) to position (%.2f, %.2f, %.2f)\n", 
-                        drone_id, drone_shared_mem->current_step, dx, dy, dz, current_pos_x, current_pos_y, current_pos_z);
-
-                // Atualiza a sua posição na memória partilhada
-                pthread_mutex_lock(&drone_shared_mem->mutex);
-
-                if (drone_shared_mem->drones[drone_id].active){
-                    drone_shared_mem->drones[drone_id].x = current_pos_x;
-                    drone_shared_mem->drones[drone_id].y = current_pos_y;
-                    drone_shared_mem->drones[drone_id].z = current_pos_z;
-                    drone_shared_mem->drones[drone_id].time = time;
-                    drone_shared_mem->drones[drone_id].current_step = script_line_number;
-                } 
-                pthread_mutex_unlock(&drone_shared_mem->mutex);
+        if (config.broadphase == BROADPHASE_COMPARE) {
+            broadphase_brute(&positions, &reference);
+            if (!pair_lists_equal(hits, &reference)) {
+                log_event(LOG_LEVEL_QUIET, LOG_BROADPHASE_MISMATCH, shared_mem->current_step, hits->count, reference.count, NULL, 0);
             }
         }
-
-        // Sinaliza na barreira que completou o seu passo
-        sem_post(drone_barrier_sem);
-        
     }
-    // Limpa os recursos antes de terminar
-    munmap(drone_shared_mem, sizeof(SharedMemory));
-    close(drone_shm_fd);
-    sem_close(drone_barrier_sem);
-        
-    printf("Drone %d process exiting\n", drone_id); 
 }
 
-// Função para verificar e processar colisões entre drones num determinado instante de tempo da simulação
-void check_collisions()
+// Registo: guarda as colisões encontradas e termina os drones envolvidos (com o mutex global)
+void record_collisions(const PairList *hits)
 {
-    printf("\nChecking for collisions\n");
-
     // Primeiro, identifica todas as colisões sem terminar nenhum drone
-    bool will_terminate[MAX_DRONES] = {false};
+    bool *will_terminate = calloc(shared_mem->drone_count, sizeof(bool));
+    if (!will_terminate) {
+        perror("Failed to allocate termination flags");
+        exit(EXIT_FAILURE);
+    }
     //pthread_mutex_lock(&shared_mem->mutex);
     shared_mem->collision_detected = false;
 
-    // Itera por todos os pares de drones ativos
-    for (int i = 0; i < shared_mem->drone_count; i++){
-
-        if (!shared_mem->drones[i].active){
-            continue; // Avança drones inativos
+    for (int k = 0; k < hits->count; k++){
+        int i = hits->pairs[k].i;
+        int j = hits->pairs[k].j;
+        double distance = hits->pairs[k].distance;
+
+        log_event(LOG_LEVEL_STEPS, LOG_COLLISION_ALERT, i, j, 0, &distance, 1);
+        // Guarda as colisões
+        if(shared_mem->collision_count < shared_mem->max_collisions){
+            shm_collisions(shared_mem)[shared_mem->collision_count].drone1_id = i;
+            shm_collisions(shared_mem)[shared_mem->collision_count].drone2_id = j;
+            shm_collisions(shared_mem)[shared_mem->collision_count].distance = distance;
+            shm_collisions(shared_mem)[shared_mem->collision_count].time = shared_mem->current_step;
+            shm_collisions(shared_mem)[shared_mem->collision_count].x1 = shared_mem->drones[i].x;
+            shm_collisions(shared_mem)[shared_mem->collision_count].y1 = shared_mem->drones[i].y;
+            shm_collisions(shared_mem)[shared_mem->collision_count].z1 = shared_mem->drones[i].z;
+            shm_collisions(shared_mem)[shared_mem->collision_count].x2 = shared_mem->drones[j].x;
+            shm_collisions(shared_mem)[shared_mem->collision_count].y2 = shared_mem->drones[j].y;
+            shm_collisions(shared_mem)[shared_mem->collision_count].z2 = shared_mem->drones[j].z;
+            shm_collisions(shared_mem)[shared_mem->collision_count].processed = false;
+            collision_queue_push(shared_mem->collision_count);
+            shared_mem->collision_count++;
+
+            will_terminate[i] = true;
+            will_terminate[j] = true;
         }
 
-        for (int j = i + 1; j < shared_mem->drone_count; j++){
-            // Calcula a distância entre drones
-            if (!shared_mem->drones[j].active){
-                continue; // Avança drones inativos
-            }
-
-            // Calcula a distância euclidiana entre os dois drones
-            double dx = shared_mem->drones[i].x - shared_mem->drones[j].x;
-
-            double dy = shared_mem->drones[i].y - shared_mem->drones[j].y;
-
-            double dz = shared_mem->drones[i].z - shared_mem->drones[j].z;
-
-            double distance = sqrt(dx * dx + dy * dy + dz * dz);
-
-            if (distance < COLLISION_THRESHOLD)
-            {
-                printf("COLLISION ALERT: Drones %d and %d are too close (%.2f meters)!\n\n", i, j, distance);
-                // Guarda as colisões
-                if(shared_mem->collision_count < MAX_COLLISIONS){
-                    shared_mem->collisions[shared_mem->collision_count].drone1_id = i;
-                    shared_mem->collisions[shared_mem->collision_count].drone2_id = j;
-                    shared_mem->collisions[shared_mem->collision_count].distance = distance;
-                    shared_mem->collisions[shared_mem->collision_count].time = shared_mem->current_step;
-                    shared_mem->collisions[shared_mem->collision_count].x1 = shared_mem->drones[i].x;
-                    shared_mem->collisions[shared_mem->collision_count].y1 = shared_mem->drones[i].y;
-                    shared_mem->collisions[shared_mem->collision_count].z1 = shared_mem->drones[i].z;
-                    shared_mem->collisions[shared_mem->collision_count].x2 = shared_mem->drones[j].x;
-                    shared_mem->collisions[shared_mem->collision_count].y2 = shared_mem->drones[j].y;
-                    shared_mem->collisions[shared_mem->collision_count].z2 = shared_mem->drones[j].z;
-                    shared_mem->collisions[shared_mem->collision_count].processed = false;
-                    shared_mem->collision_count++;
-
-                    will_terminate[i] = true;
-                    will_terminate[j] = true;
-                }
-
-                shared_mem->collision_detected = true;
-            }
-        }
+        shared_mem->collision_detected = true;
     }
 
     // Termina todos os drones que foram marcados para terminação
@@ -739,17 +3139,18 @@ void check_collisions()
 
             terminate_drone(i, SIGUSR1);
             //printf("Collision %d recorded. Drones %d TERMINATED. (Total collisions: %d/%d)\n", 
-            //           shared_mem->collision_count, i, shared_mem->collision_count, MAX_COLLISIONS);
+            //           shared_mem->collision_count, i, shared_mem->collision_count, shared_mem->max_collisions);
         }
     }
+    free(will_terminate);
 
     if (!shared_mem->collision_detected) {
-        printf("No collisions detected at step %d\n", shared_mem->current_step);
+        log_event(LOG_LEVEL_STEPS, LOG_NO_COLLISIONS, shared_mem->current_step, 0, 0, NULL, 0);
     } else {
+        // Sinaliza a thread de relatório que há colisões novas na fila (com o mutex adquirido)
         pthread_cond_signal(&shared_mem->collision_cond);
 
-        // Sinaliza a thread de relatório que houve uma nova colisão
-        printf("Total collisions so far: %d/%d\n", shared_mem->collision_count, MAX_COLLISIONS);
+        log_event(LOG_LEVEL_STEPS, LOG_COLLISION_TOTAL, shared_mem->collision_count, shared_mem->max_collisions, 0, NULL, 0);
     }
     //pthread_mutex_unlock(&shared_mem->mutex);
 }
@@ -769,6 +3170,17 @@ void cleanup_simulation()
         }
     }
 
+    // No executor "pool" os processos filho são os workers
+    for (int w = 0; pool_pids && w < runner_count; w++) {
+        if (pool_pids[w] > 0) {
+            kill(pool_pids[w], SIGTERM);
+        }
+    }
+    free(pool_pids);
+    free(pool_slice_first);
+    pool_pids = NULL;
+    pool_slice_first = NULL;
+
     int status;
     pid_t pid;
 
@@ -789,53 +3201,72 @@ void clenup_shared_memory_semaphores(){
         pthread_mutex_destroy(&shared_mem->mutex);
         pthread_cond_destroy(&shared_mem->step_cond);
         pthread_cond_destroy(&shared_mem->collision_cond);
-        munmap(shared_mem, sizeof(SharedMemory));
+        munmap(shared_mem, shared_mem->segment_size);
     }
 
     // Fecha e remove o ficheiro de memória partilhada
     if (fd >= 0) {
         close(fd);
-        shm_unlink(SHM_NAME);
+        shm_unlink(shm_name);
     }
 
     // Limpa os semáforos nomeados    
     if (barrier_sem && barrier_sem != SEM_FAILED) {
         sem_close(barrier_sem);
-        sem_unlink(SEM_BARRIER_NAME);
+        sem_unlink(sem_barrier_name);
     }
     if (phase_sem && phase_sem != SEM_FAILED) {
         sem_close(phase_sem);
-        sem_unlink(SEM_PHASE);
+        sem_unlink(sem_phase_name);
     }
 
     // Limpa os semáforos individuais dos drones
-    char drone_semaphore[32];
-    for (int i = 0; i < MAX_DRONES; i++) {
+    char drone_semaphore[64];
+    for (int i = 0; drone_sem && i < drone_sem_count; i++) {
         if (drone_sem[i] && drone_sem[i] != SEM_FAILED) {
             sem_close(drone_sem[i]);
-            sprintf(drone_semaphore,"/drone_sem_%d",i);
+            sprintf(drone_semaphore,"/drone_sem_%d%s",i,ipc_suffix);
             sem_unlink(drone_semaphore);
         }
     }
+    free(drone_sem);
+    drone_sem = NULL;
+    drone_sem_count = 0;
 
 }
 
-// Função para contar o número de linhas num ficheiro
-int count_lines(const char *filename)
+// Função para acrescentar um script à tabela de trajetória da figura; devolve o número de movimentos lidos
+int load_script(const char *filename, Figure *figure)
 {
     if (filename == NULL) return 0;
     FILE *file = fopen(filename, "r");
     if (!file)
     {
-        perror("Error opening file");
+        perror("Error opening drone script file!");
         return -1;
     }
     int count = 0;
 
-    // Declara um buffer de caracteres para armazenar temporariamente as linhas lidas do ficheiro.
+    // Interpreta cada linha (tempo dx dy dz) uma única vez; linhas inválidas são ignoradas
     char buffer[1024];
     while (fgets(buffer, sizeof(buffer), file) != NULL){
-        count++;
+        if (figure->step_count == figure->step_capacity) {
+            int new_capacity = figure->step_capacity ? figure->step_capacity * 2 : 256;
+            ScriptStep *steps = realloc(figure->steps, new_capacity * sizeof(ScriptStep));
+            if (!steps) {
+                perror("Failed to allocate trajectory table");
+                fclose(file);
+                return -1;
+            }
+            figure->steps = steps;
+            figure->step_capacity = new_capacity;
+        }
+
+        ScriptStep *step = &figure->steps[figure->step_count];
+        if (sscanf(buffer, "%lf %lf %lf %lf", &step->time, &step->dx, &step->dy, &step->dz) == 4){
+            figure->step_count++;
+            count++;
+        }
     }
 
     // Fecha o ficheiro após a leitura de todas as linhas.
@@ -858,11 +3289,15 @@ void terminate_drone(int drone_id, int code)
         return; // Drone já inativo
     }
 
-    printf("Terminating drone %d \n", drone_id);
+    log_event(LOG_LEVEL_STEPS, LOG_TERMINATING, drone_id, 0, 0, NULL, 0);
 
-    // Enviar sinal de terminação para o processo do drone
+    // Enviar sinal de terminação para o processo do drone (no executor de threads não há processo)
 
-    kill(shared_mem->drones[drone_id].pid, code);
+    // Com --pipeline não há sinais: o drone pode estar a calcular o passo seguinte e tem de chegar
+    // à barreira; sai quando deixar de estar escalonado e o seu frame deixa de ser aceite
+    if (shared_mem->drones[drone_id].pid > 0 && !config.pipeline) {
+        kill(shared_mem->drones[drone_id].pid, code);
+    }
 
     // Marcar o drone como inativo
     // Isso evita que o drone seja processado novamente na simulação.
@@ -885,10 +3320,10 @@ void terminate_drone_all()
 
         if (shared_mem->drones[i].active)
         {
-            pthread_mutex_lock(&shared_mem->mutex);
+            shm_lock(shared_mem);
             terminate_drone(i, SIGTERM);
-            pthread_cond_signal(&shared_mem->collision_cond);~
-            pthread_mutex_unlock(&shared_mem->mutex);
+            pthread_cond_signal(&shared_mem->collision_cond);
+            shm_unlock(shared_mem);
 
 
         }
@@ -899,7 +3334,7 @@ void terminate_drone_all()
 void generate_report()
 {
     if (!shared_mem) return;
-    FILE *report_file = fopen(REPORT_FILENAME, "w");
+    FILE *report_file = fopen(report_filename, "w");
     if (!report_file){
         perror("Error creating report file!");
         return;
@@ -939,8 +3374,8 @@ void generate_report()
         } else if (!shared_mem->drones[i].active) {
             bool involved_in_collision = false;
             for (int j = 0; j < shared_mem->collision_count; j++) {
-                if (shared_mem->collisions[j].drone1_id == i || 
-                    shared_mem->collisions[j].drone2_id == i) {
+                if (shm_collisions(shared_mem)[j].drone1_id == i || 
+                    shm_collisions(shared_mem)[j].drone2_id == i) {
                     involved_in_collision = true;
                     break;
                 }
@@ -963,15 +3398,15 @@ void generate_report()
         for (int i = 0; i < shared_mem->collision_count; i++){
             fprintf(report_file, "Collision %d:\n", i + 1);
             fprintf(report_file, "  Drones Involved: %d and %d\n",
-                    shared_mem->collisions[i].drone1_id, shared_mem->collisions[i].drone2_id);
-            fprintf(report_file, "  Time: %.2f seconds\n", shared_mem->collisions[i].time);
-            fprintf(report_file, "  Distance between them: %.2f meters\n", shared_mem->collisions[i].distance);
+                    shm_collisions(shared_mem)[i].drone1_id, shm_collisions(shared_mem)[i].drone2_id);
+            fprintf(report_file, "  Time: %.2f seconds\n", shm_collisions(shared_mem)[i].time);
+            fprintf(report_file, "  Distance between them: %.2f meters\n", shm_collisions(shared_mem)[i].distance);
             fprintf(report_file, "  Drone %d Position: (%.2f, %.2f, %.2f)\n",
-                    shared_mem->collisions[i].drone1_id,
-                    shared_mem->collisions[i].x1, shared_mem->collisions[i].y1, shared_mem->collisions[i].z1);
+                    shm_collisions(shared_mem)[i].drone1_id,
+                    shm_collisions(shared_mem)[i].x1, shm_collisions(shared_mem)[i].y1, shm_collisions(shared_mem)[i].z1);
             fprintf(report_file, "  Drone %d Position: (%.2f, %.2f, %.2f)\n\n",
-                    shared_mem->collisions[i].drone2_id,
-                    shared_mem->collisions[i].x2, shared_mem->collisions[i].y2, shared_mem->collisions[i].z2);
+                    shm_collisions(shared_mem)[i].drone2_id,
+                    shm_collisions(shared_mem)[i].x2, shm_collisions(shared_mem)[i].y2, shm_collisions(shared_mem)[i].z2);
         }
     }
 
@@ -985,23 +3420,30 @@ void generate_report()
         fprintf(report_file, "Consider adjusting the paths of the following drones:\n");
         for (int i = 0; i < shared_mem->collision_count; i++){
             fprintf(report_file, "- Drones %d and %d (collided at time %.2f)\n",
-                   shared_mem->collisions[i].drone1_id, shared_mem->collisions[i].drone2_id, shared_mem->collisions[i].time);
+                   shm_collisions(shared_mem)[i].drone1_id, shm_collisions(shared_mem)[i].drone2_id, shm_collisions(shared_mem)[i].time);
         }
     }else{
         fprintf(report_file, "The figure is safe to use.\nAll drones completed their paths without collisions.\n");
     }
 
+    // Histogramas de tempos por fase (--timing sem ficheiro próprio)
+    if (config.timing && !config.timing_file) {
+        fprintf(report_file, "\n");
+        write_timing_stats(report_file);
+    }
+
     fclose(report_file);
-    printf("Simulation report generated: %s\n", REPORT_FILENAME);
+    printf("Simulation report generated: %s\n", report_filename);
 }
 
 // Função executada pela thread de deteção de colisões
 void* collision_detection_thread(void* arg)
 {
     printf("Collision detection thread started\n");
+    PairList hits = {0};
 
     while (shared_mem->threads_running && !shared_mem->termination_requested) {
-        pthread_mutex_lock(&shared_mem->mutex);
+        shm_lock(shared_mem);
 
         // Espera até que um passo de simulação esteja em progresso
         while (!shared_mem->step_in_progress && shared_mem->threads_running && !shared_mem->termination_requested) {
@@ -1010,22 +3452,33 @@ void* collision_detection_thread(void* arg)
 
         // Sai do loop se a simulação terminou
         if (!shared_mem->threads_running || shared_mem->termination_requested ) {
-            pthread_mutex_unlock(&shared_mem->mutex);
+            shm_unlock(shared_mem);
             break;
         }
 
         // Verifica colisões
         if(shared_mem->step_in_progress && !shared_mem->collisions_checked){
-            check_collisions();
+            unsigned long phase_start = timing_start();
+            if (config.publish == PUBLISH_SEQLOCK) {
+                // A deteção lê as posições pelo seqlock: o mutex só é retomado para registar as colisões
+                shm_unlock(shared_mem);
+                find_collision_pairs(&hits);
+                shm_lock(shared_mem);
+                record_collisions(&hits);
+            } else {
+                check_collisions();
+            }
+            timing_record(TIMING_COLLISION_CHECK, phase_start);
             // Notifica a thread de geração de relatórios que as colisões foram verificadas
             shared_mem->collisions_checked = true;
             pthread_cond_signal(&shared_mem->ready);
         }
-        pthread_mutex_unlock(&shared_mem->mutex);
+        shm_unlock(shared_mem);
     }
 
     
 
+    free(hits.pairs);
     printf("Collision detection thread terminated\n");
     return NULL;
 }
@@ -1034,38 +3487,92 @@ void* collision_detection_thread(void* arg)
 void* report_generation_thread(void* arg)
 {
     printf("Report generation thread started\n");
+    int processed = 0;
+    int wakeups = 0;
+    int index;
+
+    while (true) {
+        // Processa as colisões novas publicadas na fila
+        while (collision_queue_pop(&index)) {
+           // printf("Report: Processing collision between drones %d and %d at step %.0f\n",
+           //        shm_collisions(shared_mem)[index].drone1_id,
+           //        shm_collisions(shared_mem)[index].drone2_id,
+           //        shm_collisions(shared_mem)[index].time);
+            shm_collisions(shared_mem)[index].processed = true;
+            processed++;
+        }
 
-    while (shared_mem->threads_running && !shared_mem->termination_requested) {
-        pthread_mutex_lock(&shared_mem->mutex);
-
-        // Processa collisiões não processadas
-        for (int i = 0; i < shared_mem->collision_count; i++) {
-            if (!shared_mem->collisions[i].processed) {
-               // printf("Report: Processing collision between drones %d and %d at step %.0f\n",
-               //        shared_mem->collisions[i].drone1_id,
-               //        shared_mem->collisions[i].drone2_id,
-               //        shared_mem->collisions[i].time);
-                shared_mem->collisions[i].processed = true;
-            }
+        // Dorme em collision_cond até haver colisões novas ou a simulação terminar. Os produtores
+        // publicam e sinalizam com o mutex adquirido, por isso a verificação abaixo não perde sinais.
+        // Só o coordenador marca o fim, para que o relatório reflita sempre o estado final.
+        shm_lock(shared_mem);
+        if (shared_mem->simulation_finished) {
+            shm_unlock(shared_mem);
+            break;
+        }
+        if (!collision_queue_ready()) {
+            pthread_cond_wait(&shared_mem->collision_cond, &shared_mem->mutex);
         }
+        wakeups++;
+        shm_unlock(shared_mem);
+    }
 
-        pthread_mutex_unlock(&shared_mem->mutex);
+    // Colisões publicadas entre a última passagem e o fim da simulação
+    while (collision_queue_pop(&index)) {
+        shm_collisions(shared_mem)[index].processed = true;
+        processed++;
     }
-    
+
     // Gera o relatório final uma vez que a simulação tenha terminado
     generate_report();
+    printf("Report generation thread processed %d collisions in %d wakeups\n", processed, wakeups);
 
     printf("Report generation thread terminated\n");
     return NULL;
 }
 
+// Publica o índice de uma colisão registada na fila da thread de relatório
+void collision_queue_push(int index)
+{
+    CollisionQueue *queue = &shared_mem->collision_queue;
+    unsigned long pos = __atomic_fetch_add(&queue->head, 1, __ATOMIC_RELAXED);
+    CollisionQueueCell *cell = &shm_collision_queue(shared_mem)[pos & queue->mask];
+
+    cell->index = index;
+    cell->published = timing_start();
+    __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);
+}
+
+// Indica se a próxima colisão da fila já foi publicada
+bool collision_queue_ready()
+{
+    CollisionQueue *queue = &shared_mem->collision_queue;
+    unsigned long pos = queue->tail;
+    return __atomic_load_n(&shm_collision_queue(shared_mem)[pos & queue->mask].sequence, __ATOMIC_ACQUIRE) == pos + 1;
+}
+
+// Retira a próxima colisão da fila (só a thread de relatório consome); devolve false se estiver vazia
+bool collision_queue_pop(int *index)
+{
+    CollisionQueue *queue = &shared_mem->collision_queue;
+
+    if (!collision_queue_ready()) {
+        return false;
+    }
+    const CollisionQueueCell *cell = &shm_collision_queue(shared_mem)[queue->tail & queue->mask];
+    *index = cell->index;
+    timing_record(TIMING_REPORT_HANDOFF, cell->published);
+    queue->tail++;
+    return true;
+}
+
 // Função de sincronização que espera que todos os drones estejam prontos
 void alldronesReady()
 {
     printf("Waiting for all drones to be ready...\n");
 
-    // Espera que todos os drones estejam prontos para iniciar a simulação
-    for (int i = 0; i < shared_mem->drone_count; i++) {
+    // Espera que todos os drones (ou workers do pool) estejam prontos para iniciar a simulação
+    for (int i = 0; i < runner_count; i++) {
         sem_wait(barrier_sem);
     }
 